@@ -0,0 +1,129 @@
+#pragma once
+
+// Deterministic generator for synthetic question banks, so that QBL can be measured on banks
+// much larger than the examples.  The same settings (including the seed) always produce the
+// same bank text.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "emp/math/Random.hpp"
+
+struct BankSettings {
+  size_t num_questions = 1000;      ///< How many questions should the bank have?
+  size_t tags_per_question = 3;     ///< Regular (#) tags on each question.
+  size_t num_tags = 100;            ///< Distinct regular tags to choose from.
+  double group_density = 0.2;       ///< Fraction of questions in an exclusive (^) group.
+  size_t num_groups = 50;           ///< Distinct exclusive groups to choose from.
+  size_t min_options = 3;           ///< Fewest options on a multiple-choice question.
+  size_t max_options = 8;           ///< Most options on a multiple-choice question.
+  size_t max_correct = 3;           ///< Most correct options on a multiple-choice question.
+  double code_density = 0.1;        ///< Fraction of questions with a code block.
+  double escape_density = 0.05;     ///< Fraction of words that need escaping or markup.
+  double short_answer_density = 0.05; ///< Chance of switching to short-answer questions.
+  int seed = 1;                     ///< Random number seed for the whole bank.
+};
+
+class BankGenerator {
+private:
+  static constexpr std::array<std::string_view, 16> WORDS = {
+    "alpha", "beta", "gamma", "delta", "the", "of", "and", "vector",
+    "map", "pointer", "class", "int", "char", "loop", "value", "function"
+  };
+
+  // Words that each output format must escape or convert.
+  static constexpr std::array<std::string_view, 16> SPECIALS = {
+    "\"", "<", ">", "&", "%", "$", "_", "#", "\\\\", "\\&Omega;", "\\<b>bold\\</b>",
+    "\\<i>it\\</i>", "`code x`", "`*bold`*", "\\&lt;", "{x}"
+  };
+
+  BankSettings settings;
+  emp::Random random;
+  std::string out;
+
+  template <size_t SIZE>
+  std::string_view _Pick(const std::array<std::string_view, SIZE> & words) {
+    return words[random.GetUInt(SIZE)];
+  }
+
+  // Add a line of min_words to max_words words (inclusive), ending in a newline.
+  void _AddText(size_t min_words, size_t max_words) {
+    out += _Pick(WORDS);
+    const size_t num_words = random.GetUInt(min_words, max_words + 1);
+    for (size_t i = 1; i < num_words; ++i) {
+      out += ' ';
+      out += random.P(settings.escape_density) ? _Pick(SPECIALS) : _Pick(WORDS);
+    }
+    out += '\n';
+  }
+
+  // Questions in an exclusive group never get tag #t0, so including #t0 cannot conflict.
+  void _AddTags() {
+    const bool in_group = random.P(settings.group_density);
+    const size_t first_tag = (in_group && settings.num_tags > 1) ? 1 : 0;
+    for (size_t i = 0; i < settings.tags_per_question; ++i) {
+      if (i) out += ' ';
+      out += "#t" + std::to_string(random.GetUInt(first_tag, settings.num_tags));
+    }
+    if (!settings.tags_per_question) out += "#none";
+    if (in_group) out += " ^g" + std::to_string(random.GetUInt(settings.num_groups));
+    out += '\n';
+  }
+
+  void _AddMultipleChoice() {
+    const size_t num_options = random.GetUInt(settings.min_options, settings.max_options + 1);
+    const size_t max_correct =
+      std::clamp<size_t>(num_options / 3, 1, std::max<size_t>(settings.max_correct, 1));
+    const size_t num_correct = random.GetUInt(1, max_correct + 1);
+    if (num_correct > 1) out += ":correct=1-" + std::to_string(num_correct) + '\n';
+    if (num_options > 4 && random.P(0.5)) {
+      out += ":options=4-" + std::to_string(num_options) + '\n';
+    }
+
+    // Correct options are a run (wrapping around) that starts at a random position.
+    const size_t first_correct = random.GetUInt(num_options);
+    for (size_t i = 0; i < num_options; ++i) {
+      const bool is_correct = (i + num_options - first_correct) % num_options < num_correct;
+      out += is_correct ? "[*] " : "* ";
+      _AddText(2, 10);
+    }
+  }
+
+  void _AddShortAnswer() {
+    const size_t num_answers = random.GetUInt(1, 3);
+    for (size_t i = 0; i < num_answers; ++i) {
+      out += "> ";
+      out += _Pick(WORDS);
+      out += '\n';
+    }
+  }
+
+public:
+  BankGenerator(const BankSettings & _settings)
+    : settings(_settings), random(_settings.seed) { }
+
+  // Produce the text of a complete question bank.
+  std::string Generate() {
+    out = "/multiple_choice\n";   // Don't depend on the type left by any earlier file.
+    bool is_short_answer = false;
+    for (size_t q_id = 0; q_id < settings.num_questions; ++q_id) {
+      if (random.P(settings.short_answer_density) != is_short_answer) {
+        is_short_answer = !is_short_answer;
+        out += is_short_answer ? "/short_answer\n" : "/multiple_choice\n";
+      }
+      _AddText(6, 20);
+      if (random.P(settings.code_density)) {
+        out += "    int x" + std::to_string(q_id) + " = v[i] < 3 && s != \"%\";\n";
+        out += "      return x" + std::to_string(q_id) + " * 2;  // <code> & {x}\n";
+      }
+      _AddTags();
+      if (is_short_answer) _AddShortAnswer();
+      else _AddMultipleChoice();
+      out += '\n';
+    }
+    return out;
+  }
+};
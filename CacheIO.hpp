@@ -0,0 +1,285 @@
+#pragma once
+
+// Tools for reading and writing compiled question banks (.qblc files).
+//
+// A compiled bank starts with a header that identifies every source file by name, size,
+// file times, and a hash of its contents, followed by the bank's tag dictionary (so each
+// tag is stored only once and questions refer to tags by ID) and then the questions themselves.
+// Variable-length data is stored as blobs that are copied back into a TextArena in a single
+// step, so loading a question needs no allocations of its own.  All values
+// are stored in native byte order; a cache is meant to be rebuilt on the machine that uses it,
+// not distributed.
+
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <sys/stat.h>
+
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+#include "TagDictionary.hpp"
+#include "TextArena.hpp"
+
+static constexpr uint32_t QBLC_MAGIC = 0x434C4251;  // "QBLC" in little-endian order.
+static constexpr uint32_t QBLC_VERSION = 4;         // Bump whenever the layout changes.
+
+// Identify a single source file used to build a cache.
+struct CacheSource {
+  emp::String filename;
+  uint64_t size = 0;
+  int64_t mtime = 0;    ///< Modification time in nanoseconds (0 if unknown).
+  int64_t ctime = 0;    ///< Status change time in nanoseconds (cannot be set back by tools).
+  uint64_t hash = 0;    ///< Hash of the file contents (0 until computed).
+};
+
+// 64-bit hash of a block of bytes.  Input is read eight bytes at a time into four independent
+// lanes (the structure of xxHash64), so hashing runs at close to memory speed.
+static inline uint64_t HashBytes(std::string_view bytes) {
+  static constexpr uint64_t P1 = 0x9E3779B185EBCA87ull;
+  static constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+  static constexpr uint64_t P3 = 0x165667B19E3779F9ull;
+  static constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+  static constexpr uint64_t P5 = 0x27D4EB2F165667C5ull;
+  auto read64 = [](const char * ptr){ uint64_t value; std::memcpy(&value, ptr, 8); return value; };
+  auto round = [](uint64_t acc, uint64_t input){ return std::rotl(acc + input * P2, 31) * P1; };
+
+  const char * ptr = bytes.data();
+  const char * const end = ptr + bytes.size();
+  uint64_t hash = P5;
+  if (bytes.size() >= 32) {
+    uint64_t lanes[4] = { P1 + P2, P2, 0, 0 - P1 };
+    for (; end - ptr >= 32; ptr += 32) {
+      for (size_t i = 0; i < 4; ++i) lanes[i] = round(lanes[i], read64(ptr + 8*i));
+    }
+    hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7)
+         + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+    for (uint64_t lane : lanes) hash = (hash ^ round(0, lane)) * P1 + P4;
+  }
+  hash += bytes.size();
+  for (; end - ptr >= 8; ptr += 8) hash = std::rotl(hash ^ round(0, read64(ptr)), 27) * P1 + P4;
+  for (; ptr < end; ++ptr) {
+    hash = std::rotl(hash ^ (static_cast<unsigned char>(*ptr) * P5), 11) * P1;
+  }
+  hash ^= hash >> 33;
+  hash *= P2;
+  hash ^= hash >> 29;
+  hash *= P3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+// Read a whole file into a string; returns false if the file cannot be read.
+static inline bool ReadFileBytes(const emp::String & filename, std::string & out) {
+  std::ifstream file(std::string(filename.begin(), filename.end()), std::ios::binary);
+  if (!file) return false;
+  file.seekg(0, std::ios::end);
+  out.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0, std::ios::beg);
+  file.read(out.data(), static_cast<std::streamsize>(out.size()));
+  return static_cast<bool>(file);
+}
+
+// Collect the size and modification and change times of each source file.  Contents are only
+// hashed when needed (see HashCacheSources), since checking an up-to-date cache should not
+// require reading every source.
+static inline emp::vector<CacheSource> MakeCacheSources(const emp::vector<emp::String> & files) {
+  emp::vector<CacheSource> sources;
+  for (const emp::String & filename : files) {
+    CacheSource & source = sources.emplace_back();
+    source.filename = filename;
+    struct stat info;
+    if (stat(std::string(filename.begin(), filename.end()).c_str(), &info) != 0) continue;
+    source.size = static_cast<uint64_t>(info.st_size);
+    source.mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1'000'000'000
+                 + info.st_mtim.tv_nsec;
+    source.ctime = static_cast<int64_t>(info.st_ctim.tv_sec) * 1'000'000'000
+                 + info.st_ctim.tv_nsec;
+  }
+  return sources;
+}
+
+// Hash the contents of a source file; returns false if it cannot be read.
+static inline bool HashCacheSource(CacheSource & source) {
+  std::string contents;
+  if (!ReadFileBytes(source.filename, contents)) return false;
+  source.hash = HashBytes(contents);
+  return true;
+}
+
+// Hash every source that has not been hashed yet.
+static inline void HashCacheSources(emp::vector<CacheSource> & sources) {
+  for (CacheSource & source : sources) {
+    if (source.hash == 0) HashCacheSource(source);
+  }
+}
+
+class CacheWriter {
+private:
+  const TagDictionary & tags;   ///< Dictionary that all tag IDs refer to.
+  std::string body;             ///< Serialized questions.
+
+  template <typename T>
+  static void _WriteRaw(std::string & out, T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  static void _WriteString(std::string & out, std::string_view str) {
+    _WriteRaw<uint64_t>(out, str.size());
+    out.append(str);
+  }
+  static void _WriteString(std::string & out, const emp::String & str) {
+    _WriteString(out, str.View());
+  }
+
+public:
+  CacheWriter(const TagDictionary & tags) : tags(tags) { }
+
+  template <typename T>
+  void Write(T value) { _WriteRaw(body, value); }
+
+  void Write(const emp::String & str) { _WriteString(body, str); }
+  void Write(std::string_view str) { _WriteString(body, str); }
+
+  // Arrays of plain values are written as a count followed by the raw values.
+  template <typename T>
+  void WriteArray(std::span<const T> values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    Write<uint64_t>(values.size());
+    body.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+  }
+  template <typename T>
+  void WriteArray(const emp::vector<T> & values) {
+    WriteArray(std::span<const T>(values.data(), values.size()));
+  }
+
+  // Assemble the full cache file: header, tag dictionary, then body.
+  bool Save(const emp::String & filename, const emp::vector<CacheSource> & sources) const {
+    // A file modified in the last few seconds could change again without its modification
+    // time changing, so force its contents to be checked on the next load.
+    const int64_t recent = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      (std::chrono::system_clock::now() - std::chrono::seconds(2)).time_since_epoch()).count();
+
+    std::string header;
+    _WriteRaw(header, QBLC_MAGIC);
+    _WriteRaw(header, QBLC_VERSION);
+    _WriteRaw<uint64_t>(header, sources.size());
+    for (const auto & source : sources) {
+      _WriteString(header, source.filename);
+      _WriteRaw(header, source.size);
+      _WriteRaw<int64_t>(header, source.mtime < recent ? source.mtime : 0);
+      _WriteRaw(header, source.ctime);
+      _WriteRaw(header, source.hash);
+    }
+    _WriteRaw<uint64_t>(header, tags.size());
+    for (size_t tag_id = 0; tag_id < tags.size(); ++tag_id) {
+      _WriteString(header, tags.GetName(static_cast<TagDictionary::tag_id_t>(tag_id)));
+    }
+
+    std::ofstream file(std::string(filename.begin(), filename.end()), std::ios::binary);
+    if (!file) return false;
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+    file.write(body.data(), static_cast<std::streamsize>(body.size()));
+    return static_cast<bool>(file);
+  }
+};
+
+class CacheReader {
+private:
+  TextArena & arena;                 ///< Where text and arrays are placed as they are read.
+  std::string data;                  ///< Full contents of the cache file.
+  size_t pos = 0;                    ///< Current read position in data.
+  bool ok = true;                    ///< Has every read so far been valid?
+  emp::vector<emp::String> tags;     ///< Tag dictionary loaded from the header, by ID.
+
+  template <typename T>
+  T _ReadRaw() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    T value{};
+    if (!ok || pos + sizeof(T) > data.size()) { ok = false; return value; }
+    std::memcpy(&value, data.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+  }
+
+public:
+  CacheReader(TextArena & arena) : arena(arena) { }
+
+  // Load the cache file and check that it was built from the provided sources.  A source
+  // with the same size, modification time, and change time as when the cache was built is
+  // taken to be unchanged; otherwise its contents are hashed (and the hash kept in sources).
+  bool Open(const emp::String & filename, emp::vector<CacheSource> & sources) {
+    if (!ReadFileBytes(filename, data)) return false;
+    if (Read<uint32_t>() != QBLC_MAGIC || Read<uint32_t>() != QBLC_VERSION) return false;
+    if (Read<uint64_t>() != sources.size()) return false;
+    for (auto & source : sources) {
+      const emp::String cached_name = ReadString();
+      const uint64_t cached_size = Read<uint64_t>();
+      const int64_t cached_mtime = Read<int64_t>();
+      const int64_t cached_ctime = Read<int64_t>();
+      const uint64_t cached_hash = Read<uint64_t>();
+      if (!ok || cached_name != source.filename || cached_size != source.size) return false;
+      if (cached_mtime != 0 && cached_mtime == source.mtime && cached_ctime == source.ctime) {
+        source.hash = cached_hash;
+      }
+      else if (!HashCacheSource(source) || source.hash != cached_hash) return false;
+    }
+    const uint64_t tag_count = Read<uint64_t>();
+    for (uint64_t i = 0; i < tag_count && ok; ++i) tags.push_back(ReadString());
+    return ok;
+  }
+
+  bool IsOK() const { return ok; }
+  void SetError() { ok = false; }  ///< Mark the cache as unusable (e.g., inconsistent contents).
+  bool AtEnd() const { return pos >= data.size(); }
+  const emp::vector<emp::String> & GetTags() const { return tags; }
+  TextArena & GetArena() { return arena; }
+
+  template <typename T>
+  T Read() { return _ReadRaw<T>(); }
+
+  emp::String ReadString() {
+    const uint64_t size = Read<uint64_t>();
+    if (!ok || size > data.size() - pos) { ok = false; return ""; }
+    emp::String out(std::string_view(data.data() + pos, size));
+    pos += size;
+    return out;
+  }
+
+  // Read text into the arena.
+  std::string_view ReadText() {
+    const uint64_t size = Read<uint64_t>();
+    if (!ok || size > data.size() - pos) { ok = false; return {}; }
+    const std::string_view out = arena.AddText(std::string_view(data.data() + pos, size));
+    pos += size;
+    return out;
+  }
+
+  // Read an array of plain values into the arena.
+  template <typename T>
+  std::span<const T> ReadArray() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const uint64_t count = Read<uint64_t>();
+    if (!ok || count > (data.size() - pos) / sizeof(T)) { ok = false; return {}; }
+    // The data may not be aligned for T, so copy it in bytes.
+    std::span<T> out = arena.NewArray<T>(count);
+    if (count) std::memcpy(out.data(), data.data() + pos, count * sizeof(T));
+    pos += count * sizeof(T);
+    return out;
+  }
+
+  // Read an array of tag IDs, checking that each is in the dictionary.
+  std::span<const TagDictionary::tag_id_t> ReadTagIDs() {
+    auto tag_ids = ReadArray<TagDictionary::tag_id_t>();
+    for (auto tag_id : tag_ids) if (tag_id >= tags.size()) ok = false;
+    return tag_ids;
+  }
+};
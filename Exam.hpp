@@ -0,0 +1,46 @@
+#pragma once
+
+// An Exam is a lightweight view onto a QuestionBank: which questions were chosen, in what
+// order, and how each one should be presented.  The bank itself is never modified, so a
+// single loaded bank can produce any number of exams.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "emp/base/vector.hpp"
+
+// How a single question should be presented on an exam.
+struct QuestionLayout {
+  bool use_alt = false;                 ///< Use alternate wording (negating option correctness)?
+  emp::vector<uint32_t> option_order;   ///< Options to show, in order (positions in question).
+};
+
+// A question chosen for an exam.
+struct ExamEntry {
+  size_t bank_pos = 0;                  ///< Position of this question in the bank.
+  QuestionLayout layout;                ///< How to present this question.
+};
+
+// Extra work done while generating an exam (reported with --stats).
+struct GenerateCounts {
+  size_t rejected_draws = 0;            ///< Random picks of questions that could not be used.
+  size_t group_conflicts = 0;           ///< Questions ruled out by an exclusive group.
+  size_t option_collisions = 0;         ///< Option samples that repeated an earlier pick.
+
+  GenerateCounts & operator+=(const GenerateCounts & in) {
+    rejected_draws += in.rejected_draws;
+    group_conflicts += in.group_conflicts;
+    option_collisions += in.option_collisions;
+    return *this;
+  }
+};
+
+struct Exam {
+  emp::vector<ExamEntry> entries;       ///< Questions on this exam, in order.
+  size_t include_count = 0;             ///< Number of questions selected during generation.
+  size_t exclude_count = 0;             ///< Number of questions ruled out during generation.
+  GenerateCounts counts;                ///< Extra work done during generation.
+
+  size_t size() const { return entries.size(); }
+  const ExamEntry & operator[](size_t pos) const { return entries[pos]; }
+};
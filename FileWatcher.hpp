@@ -0,0 +1,86 @@
+#pragma once
+
+// Watch a set of files for changes using inotify.  Directories are watched rather than the
+// files themselves, so that editors which save by writing a new file and renaming it over
+// the old one are still noticed.
+
+#include <algorithm>
+#include <cerrno>
+#include <string>
+#include <string_view>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+class FileWatcher {
+public:
+  static constexpr int SETTLE_MS = 100;   ///< Quiet time that ends a burst of changes.
+
+private:
+  struct Watch {
+    int wd;                       ///< inotify watch descriptor for the file's directory.
+    std::string name;             ///< Name of the file within that directory.
+    size_t file_id;               ///< Position of the file in the watched list.
+  };
+
+  int fd = -1;
+  emp::vector<Watch> watches;
+
+  // Read all pending events, adding the IDs of any watched files that changed.
+  void _ReadEvents(emp::vector<size_t> & changed) {
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+      const ssize_t count = ::read(fd, buffer, sizeof(buffer));
+      if (count < 0 && errno == EINTR) continue;
+      if (count <= 0) return;
+      for (ssize_t pos = 0; pos < count; ) {
+        const auto * event = reinterpret_cast<const inotify_event *>(buffer + pos);
+        pos += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        if (!event->len) continue;
+        const std::string_view name(event->name);
+        for (const Watch & watch : watches) {
+          if (watch.wd == event->wd && watch.name == name) changed.push_back(watch.file_id);
+        }
+      }
+    }
+  }
+
+  bool _WaitReadable(int timeout_ms) const {
+    pollfd pfd{fd, POLLIN, 0};
+    return ::poll(&pfd, 1, timeout_ms) > 0 && (pfd.revents & POLLIN);
+  }
+
+public:
+  FileWatcher(const emp::vector<emp::String> & filenames) {
+    fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return;
+    for (size_t file_id = 0; file_id < filenames.size(); ++file_id) {
+      const std::string path(filenames[file_id].begin(), filenames[file_id].end());
+      const size_t slash_pos = path.rfind('/');
+      const std::string dir = (slash_pos == std::string::npos) ? "." : path.substr(0, slash_pos+1);
+      const std::string name = (slash_pos == std::string::npos) ? path : path.substr(slash_pos+1);
+      const int wd = ::inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+      if (wd >= 0) watches.push_back(Watch{wd, name, file_id});
+    }
+  }
+  FileWatcher(const FileWatcher &) = delete;
+  FileWatcher & operator=(const FileWatcher &) = delete;
+  ~FileWatcher() { if (fd >= 0) ::close(fd); }
+
+  bool IsOK() const { return fd >= 0; }
+
+  // Wait up to timeout_ms for watched files to change.  Once one does, keep collecting until
+  // changes stop for SETTLE_MS, then return the (sorted) IDs of every file that changed.
+  emp::vector<size_t> Wait(int timeout_ms) {
+    emp::vector<size_t> changed;
+    if (fd < 0 || !_WaitReadable(timeout_ms)) return changed;
+    do { _ReadEvents(changed); } while (_WaitReadable(SETTLE_MS));
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return changed;
+  }
+};
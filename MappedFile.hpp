@@ -0,0 +1,123 @@
+#pragma once
+
+// A read-only, memory-mapped view of a file, plus a line scanner for QBL question files.
+// Lines are handed out as std::string_view into the mapping, so no text is copied unless
+// the question bank decides to store it.  Files that may change while being read are copied
+// into memory instead (see ReadFileText), since a mapped file that shrinks faults when read.
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "emp/tools/String.hpp"
+
+class MappedFile {
+private:
+  const char * data = nullptr;   ///< Start of the mapped bytes (nullptr if empty or failed).
+  size_t size = 0;               ///< Number of bytes mapped.
+  bool is_open = false;          ///< Was the file opened successfully?
+
+public:
+  MappedFile(const emp::String & filename) {
+    const std::string name(filename.begin(), filename.end());
+    int fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info;
+    if (fstat(fd, &info) == 0) {
+      is_open = true;
+      size = static_cast<size_t>(info.st_size);
+      if (size) {
+        void * ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) { is_open = false; size = 0; }
+        else {
+          data = static_cast<const char *>(ptr);
+          madvise(ptr, size, MADV_SEQUENTIAL);
+        }
+      }
+    }
+    close(fd);
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile(MappedFile && in) : data(in.data), size(in.size), is_open(in.is_open) {
+    in.data = nullptr;
+    in.size = 0;
+  }
+  MappedFile & operator=(const MappedFile &) = delete;
+  ~MappedFile() { if (data) munmap(const_cast<char *>(data), size); }
+
+  operator bool() const { return is_open; }
+  std::string_view View() const { return data ? std::string_view(data, size) : std::string_view(); }
+};
+
+// Read a whole file into out (replacing its contents); returns false if it cannot be read.
+static inline bool ReadFileText(const emp::String & filename, std::string & out) {
+  const std::string name(filename.begin(), filename.end());
+  int fd = open(name.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat info;
+  out.clear();
+  if (fstat(fd, &info) == 0) out.reserve(static_cast<size_t>(info.st_size));
+  char buffer[1 << 16];
+  ssize_t count;
+  while ((count = read(fd, buffer, sizeof(buffer))) != 0) {
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      close(fd);
+      return false;
+    }
+    out.append(buffer, static_cast<size_t>(count));
+  }
+  close(fd);
+  return true;
+}
+
+// Test if a line of text is made up only of whitespace.
+static inline bool IsBlankLine(std::string_view line) {
+  for (char c : line) if (!std::isspace(static_cast<unsigned char>(c))) return false;
+  return true;
+}
+
+// Find the first line start at or after pos that directly follows a blank line.  Since a blank
+// line always ends a question, text can be safely divided at this point.  Returns the size of
+// the text if there is no such position.
+static inline size_t FindBlankLineBreak(std::string_view text, size_t pos) {
+  if (pos >= text.size()) return text.size();
+  if (pos > 0 && text[pos-1] != '\n') {             // Move to the start of the next line.
+    pos = text.find('\n', pos);
+    if (pos == std::string_view::npos) return text.size();
+    ++pos;
+  }
+  while (pos < text.size()) {
+    size_t line_end = text.find('\n', pos);
+    if (line_end == std::string_view::npos) return text.size();
+    const bool is_blank = IsBlankLine(text.substr(pos, line_end - pos));
+    pos = line_end + 1;
+    if (is_blank) return pos;
+  }
+  return text.size();
+}
+
+// Walk through the lines of QBL text, skipping comment lines (those beginning with '%').
+// Call line_fun(line) for each line with content and blank_fun() for each blank line.
+template <typename LINE_FUN, typename BLANK_FUN>
+static inline void ScanQBLLines(std::string_view text, LINE_FUN && line_fun, BLANK_FUN && blank_fun) {
+  const char * pos = text.data();
+  const char * const end = pos + text.size();
+  while (pos < end) {
+    const char * line_end = static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+    if (!line_end) line_end = end;
+    std::string_view line(pos, line_end - pos);
+    pos = line_end + 1;
+
+    if (line.size() && line[0] == '%') continue;   // Comment line.
+    if (IsBlankLine(line)) blank_fun();
+    else line_fun(line);
+  }
+}
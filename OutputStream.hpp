@@ -0,0 +1,185 @@
+#pragma once
+
+// Output streams with a large buffer that write to a file, to standard output, or into a
+// string.  Data is only passed on when the buffer fills or the stream is flushed or closed,
+// so the number of write calls depends on how much is written, not how many pieces it is in.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+class OutputBuffer : public std::streambuf {
+public:
+  static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+private:
+  int fd = -1;                        ///< File descriptor to write to (-1 if none).
+  bool owns_fd = false;               ///< Should fd be closed when we are done with it?
+  std::string * target = nullptr;     ///< String to append to (instead of a file descriptor).
+  std::unique_ptr<char[]> buffer;     ///< Pending output (not used for string targets).
+  bool is_ok = false;                 ///< Has everything been written successfully so far?
+  size_t bytes_written = 0;           ///< Bytes passed on so far (not counting the buffer).
+
+  // Buffers writing to a file descriptor, so that everything still pending can be written out
+  // if an error is about to end the program.
+  static std::mutex & _OpenMutex() { static std::mutex open_mutex; return open_mutex; }
+  static emp::vector<OutputBuffer *> & _OpenBuffers() {
+    static emp::vector<OutputBuffer *> open_buffers;
+    return open_buffers;
+  }
+
+  bool _Send(const char * data, size_t size) {
+    while (size && is_ok) {
+      const ssize_t count = ::write(fd, data, size);
+      if (count < 0) {
+        if (errno != EINTR) is_ok = false;
+        continue;
+      }
+      data += count;
+      size -= static_cast<size_t>(count);
+      bytes_written += static_cast<size_t>(count);
+    }
+    return is_ok;
+  }
+
+  // Pass on everything in the buffer and empty it.
+  bool _SendBuffer() {
+    if (!buffer) return is_ok;
+    const size_t size = static_cast<size_t>(pptr() - pbase());
+    setp(buffer.get(), buffer.get() + BUFFER_SIZE);
+    return _Send(buffer.get(), size);
+  }
+
+  void _SetupFD(int _fd, bool _owns_fd) {
+    fd = _fd;
+    owns_fd = _owns_fd;
+    is_ok = (fd >= 0);
+    buffer = std::make_unique<char[]>(BUFFER_SIZE);
+    setp(buffer.get(), buffer.get() + BUFFER_SIZE);
+    std::lock_guard<std::mutex> lock(_OpenMutex());
+    _OpenBuffers().push_back(this);
+  }
+
+protected:
+  int_type overflow(int_type c) override {
+    if (traits_type::eq_int_type(c, traits_type::eof())) return sync() ? c : traits_type::not_eof(c);
+    const char ch = traits_type::to_char_type(c);
+    if (target) { target->push_back(ch); ++bytes_written; return c; }
+    if (!buffer || !_SendBuffer()) return traits_type::eof();
+    *pptr() = ch;
+    pbump(1);
+    return c;
+  }
+
+  std::streamsize xsputn(const char * data, std::streamsize count) override {
+    const size_t size = static_cast<size_t>(count);
+    if (target) { target->append(data, size); bytes_written += size; return count; }
+    if (!buffer) return 0;
+    if (size > static_cast<size_t>(epptr() - pptr())) {
+      if (!_SendBuffer()) return 0;
+      if (size >= BUFFER_SIZE) return _Send(data, size) ? count : 0;  // Too big to buffer.
+    }
+    std::memcpy(pptr(), data, size);
+    pbump(static_cast<int>(size));
+    return count;
+  }
+
+  int sync() override { return _SendBuffer() ? 0 : -1; }
+
+public:
+  OutputBuffer() = default;
+  OutputBuffer(const OutputBuffer &) = delete;
+  OutputBuffer & operator=(const OutputBuffer &) = delete;
+  ~OutputBuffer() { Close(); }
+
+  bool IsOK() const { return is_ok; }
+
+  // Total bytes written to this stream, including any still in the buffer.
+  size_t GetBytesWritten() const { return bytes_written + static_cast<size_t>(pptr() - pbase()); }
+
+  // Write to a new (or truncated) file.
+  void OpenFile(const emp::String & filename) {
+    const std::string name(filename.begin(), filename.end());
+    _SetupFD(::open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644), true);
+  }
+
+  // Write to an already open file descriptor, such as STDOUT_FILENO.
+  void OpenFD(int _fd) { _SetupFD(_fd, false); }
+
+  // Append to a string in memory.
+  void OpenString(std::string & _target) {
+    target = &_target;
+    is_ok = true;
+  }
+
+  // Write out whatever every open file buffer still holds; used before exiting on an error.
+  static void FlushAll() {
+    std::lock_guard<std::mutex> lock(_OpenMutex());
+    for (OutputBuffer * open_buffer : _OpenBuffers()) open_buffer->sync();
+  }
+
+  void Close() {
+    sync();
+    if (buffer) {
+      std::lock_guard<std::mutex> lock(_OpenMutex());
+      auto & open_buffers = _OpenBuffers();
+      open_buffers.erase(std::find(open_buffers.begin(), open_buffers.end(), this));
+    }
+    if (owns_fd && fd >= 0) ::close(fd);
+    fd = -1;
+    owns_fd = false;
+    target = nullptr;
+    buffer.reset();
+    setp(nullptr, nullptr);
+  }
+};
+
+class OutputStream : public std::ostream {
+private:
+  OutputBuffer buffer;
+
+  void _Attach() {
+    rdbuf(&buffer);
+    if (!buffer.IsOK()) setstate(std::ios::badbit);
+  }
+
+public:
+  // Write to the named file.
+  OutputStream(const emp::String & filename) : std::ostream(nullptr) {
+    buffer.OpenFile(filename);
+    _Attach();
+  }
+
+  // Write to an open file descriptor.  Standard output is first flushed of anything already
+  // sent through std::cout or stdio, so output stays in order.
+  OutputStream(int fd) : std::ostream(nullptr) {
+    if (fd == STDOUT_FILENO) { std::cout.flush(); std::fflush(stdout); }
+    buffer.OpenFD(fd);
+    _Attach();
+  }
+
+  // Append to a string in memory.
+  OutputStream(std::string & target) : std::ostream(nullptr) {
+    buffer.OpenString(target);
+    _Attach();
+  }
+
+  size_t GetBytesWritten() const { return buffer.GetBytesWritten(); }
+
+  OutputStream(const OutputStream &) = delete;
+  OutputStream & operator=(const OutputStream &) = delete;
+  ~OutputStream() { flush(); }
+};
@@ -1,12 +1,29 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
 
 #include "emp/base/vector.hpp"
 #include "emp/config/FlagManager.hpp"
-#include "emp/io/File.hpp"
 #include "emp/tools/String.hpp"
 
+#include "CacheIO.hpp"
+#include "errors.hpp"
+#include "Exam.hpp"
+#include "FileWatcher.hpp"
+#include "OutputStream.hpp"
+#include "parallel.hpp"
 #include "Question.hpp"
 #include "QuestionBank.hpp"
+#include "RunStats.hpp"
+#include "SocketServer.hpp"
 
 #define QBL_VERSION "0.0.1"
 
@@ -15,6 +32,7 @@ using emp::String;
 class QBL {
 private:
   QuestionBank qbank;
+  Exam exam;                          // Questions chosen from the bank, in output order.
   emp::FlagManager flags;
 
   enum class Format {
@@ -34,12 +52,58 @@ private:
     ALPHABETIC
   };
 
-  Format format = Format::NONE;       // No format set yet.
+  // A destination for the exam: a file (split into path, name, and extension) or standard out.
+  struct Output {
+    String base_path = "";            // Where are we placing this file?
+    String base_filename = "";        // Output filename; empty=standard out
+    String extension = "";            // Provided extension to use for output file.
+    Format format = Format::NONE;     // Format to write (decided once all flags are read).
+  };
+
+  // A bank being served.  Question text is converted to each format the first time a request
+  // needs that format, and kept for later requests.  Questions that cannot be converted are
+  // remembered, so only the requests that include them fail.
+  struct ServedBank {
+    std::shared_ptr<QuestionBank> bank;
+    std::array<std::once_flag, NUM_TEXT_FORMATS> render_once;
+    std::array<std::atomic<bool>, NUM_TEXT_FORMATS> is_requested{};  // Conversion started?
+    std::array<emp::vector<String>, NUM_TEXT_FORMATS> render_errors;  // By bank position.
+
+    ServedBank(std::shared_ptr<QuestionBank> _bank) : bank(std::move(_bank)) { }
+
+    bool IsRequested(TextFormat format) const {
+      return is_requested[static_cast<size_t>(format)];
+    }
+
+    void PrepareFormat(TextFormat format, size_t threads) {
+      const size_t format_id = static_cast<size_t>(format);
+      is_requested[format_id] = true;
+      std::call_once(render_once[format_id], [this, format, format_id, threads](){
+        render_errors[format_id] = bank->TryPrepareRender(format, threads);
+      });
+    }
+
+    // Prepare the formats an exam will be printed in.  Returns the error for the first question
+    // on the exam that cannot be converted to one of them (empty if there is none).
+    String Prepare(const Exam & out_exam, const emp::vector<TextFormat> & formats,
+                   size_t threads) {
+      for (TextFormat format : formats) {
+        PrepareFormat(format, threads);
+        const auto & errors = render_errors[static_cast<size_t>(format)];
+        for (const ExamEntry & entry : out_exam.entries) {
+          if (errors[entry.bank_pos].size()) return errors[entry.bank_pos];
+        }
+      }
+      return "";
+    }
+  };
+
+  Format format = Format::NONE;       // Format set by flag; none = use output extensions.
   Order order = Order::DEFAULT;       // Don't reorder questions.
-  String base_path = "";              // Where are we placing these files?
-  String base_filename = "";          // Output filename; empty=no file
-  String extension = "";              // Provided extension to use for output file.
+  emp::vector<Output> outputs;        // Where should the exam go? (none given = standard out)
   String log_filename = "";           // Where should we log questions to?
+  String cache_filename = "";         // Compiled question bank to load from / save to.
+  String socket_path = "";            // Unix socket to serve requests on; empty=not a server.
   String title = "Multiple Choice Quiz"; // Title to use in any generated files.
   emp::vector<String> include_tags;   // Include ALL questions with these tags.
   emp::vector<String> exclude_tags;   // Exclude ALL questions with these tags (override includes)
@@ -48,8 +112,14 @@ private:
   emp::vector<String> question_files; // Full set of questions
   emp::vector<String> avoid_files;    // Files with lists of questions IDs to avoid
   size_t generate_count = 0;          // How many questions should be generated? (0 = use all)
+  size_t variant_count = 0;           // How many exam variants should be produced? (0 = single exam)
   emp::Random random;                 // Random number generator
+  size_t num_threads = DefaultThreadCount(); // Maximum number of threads to use.
   bool compressed_format = false;     // Should GradeScope output be compressed?
+  mutable std::atomic<size_t> request_count{0}; // Server requests so far (for default seeds).
+  String stats_format = "";           // Report run statistics as "text" or "json"; empty=none.
+  mutable RunStats stats;             // Time per phase and counters (reported with --stats).
+  GenerateCounts generate_counts;     // Extra work done generating all exams so far.
 
   // Helper functions
   void _AddTags(emp::vector<String> & tags, const String & arg, size_t count=1) {
@@ -71,8 +141,16 @@ public:
       "Set output file name [arg].");
     flags.AddOption('S', "--seed", [this](String arg){ SetRandomSeed(arg); },
       "Set the random number seed with the following argument [arg]");
+    flags.AddOption('V', "--variants", [this](String arg){ SetVariants(arg); },
+      "Generate [arg] exam variants from one load; \"{}\" in output/log names marks the variant.");
+    flags.AddOption('j', "--threads", [this](String arg){ SetThreads(arg); },
+      "Use at most [arg] threads (default: all available cores).");
+    flags.AddOption('U', "--serve", [this](String arg){ socket_path = arg; },
+      "Keep the bank loaded and answer exam requests on Unix socket [arg].");
     flags.AddOption('t', "--title", [this](String arg){ SetTitle(arg); },
       "Specify the quiz/exam title to use in the generated file.");
+    flags.AddOption('T', "--stats", [this](String arg){ SetStats(arg); },
+      "Report time and counters for each phase to standard error, as [arg] \"text\" or \"json\".");
 
     flags.AddGroup("Output Format",
       "These flags specify the output format to use.  If none are provided, the\n"
@@ -106,6 +184,8 @@ public:
       "Exclude all questions with following tag(s).");
     flags.AddOption('L', "--log", [this](String arg){ log_filename = arg; },
       "Log the IDs of the questions chosen to the file [arg].");
+    flags.AddOption('C', "--cache", [this](String arg){ cache_filename = arg; },
+      "Use compiled bank [arg] (.qblc); rebuilt automatically when question files change.");
     flags.AddOption('a', "--avoid", [this](String arg){ avoid_files.push_back(arg); },
       "Provide a filename ([arg]) to avoid questions from; can previously be generated as log.");
     
@@ -123,6 +203,7 @@ public:
 
     flags.Process();
     question_files = flags.GetExtras();
+    _ResolveOutputs();
   }
 
   void SetTitle(const String & in) { title = in; }
@@ -134,30 +215,48 @@ public:
     format = f;
   }
 
-  void SetOutput(String _filename, bool update_ok=false) {
-    if (base_filename.size() && !update_ok) {
-      emp::notify::Error("Only one output mode allowed at a time.");
-      exit(1);
+  // Add a file to write the exam to; may be used several times to produce several formats.
+  void SetOutput(String _filename) {
+    for (const Output & output : outputs) {
+      if (output.base_path + output.base_filename + output.extension == _filename) {
+        emp::notify::Error("Output file '", _filename, "' provided more than once.");
+        exit(1);
+      }
     }
     std::cout << "Directing output to file '" << _filename << "'." << std::endl;
+    Output & output = outputs.emplace_back();
     size_t slash_pos = _filename.RFind('/');
     if (slash_pos != emp::String::npos) {
       if (slash_pos+1 == _filename.size()) {
         emp::notify::Error("Must provide a filename (not directory) for output.");
         exit(1);
       }
-      base_path = _filename.PopFixed(slash_pos+1);
+      output.base_path = _filename.PopFixed(slash_pos+1);
     }
     size_t dot_pos = _filename.RFind('.');
-    base_filename = _filename.substr(0, dot_pos);
-    extension = _filename.View(dot_pos);
-    // If we don't have a format yet, set it based on the filename.
-    if (format == Format::NONE) {
-      if (extension == ".csv" || extension == ".d2l") format = Format::D2L;
-      if (extension == ".gscope") format = Format::GRADESCOPE;
-      else if (extension == ".html" || extension == ".htm") format = Format::WEB;
-      else if (extension == ".tex") format = Format::LATEX;
-      else if (extension == ".qbl") format = Format::QBL;
+    output.base_filename = _filename.substr(0, dot_pos);
+    output.extension = _filename.View(dot_pos);
+  }
+
+  static Format FormatFromExtension(const String & extension) {
+    if (extension == ".csv" || extension == ".d2l") return Format::D2L;
+    if (extension == ".gscope") return Format::GRADESCOPE;
+    if (extension == ".html" || extension == ".htm") return Format::WEB;
+    if (extension == ".tex") return Format::LATEX;
+    if (extension == ".qbl") return Format::QBL;
+    return Format::NONE;
+  }
+
+  // Decide the format of each output once all flags are read.  A format flag overrides the
+  // extension of a single output; with several outputs each one uses its own extension, and
+  // the flag only applies to those whose extension is not recognized.
+  void _ResolveOutputs() {
+    if (outputs.empty()) outputs.emplace_back();  // Default to standard out.
+    for (Output & output : outputs) {
+      output.format = FormatFromExtension(output.extension);
+      if (format != Format::NONE && (outputs.size() == 1 || output.format == Format::NONE)) {
+        output.format = format;
+      }
     }
   }
 
@@ -170,6 +269,23 @@ public:
     if (order == Order::DEFAULT) order = Order::RANDOM;
   }
   
+  void SetVariants(String _count) {
+    variant_count = _count.As<size_t>();
+  }
+
+  void SetStats(String _format) {
+    if (_format != "text" && _format != "json") {
+      emp::notify::Error("Unknown stats format '", _format, "'; use \"text\" or \"json\".");
+      exit(1);
+    }
+    stats_format = _format;
+  }
+
+  void SetThreads(String _count) {
+    num_threads = _count.As<size_t>();
+    if (num_threads == 0) num_threads = 1;
+  }
+
   void SetRandomSeed(String _seed) {
     int random_seed = _seed.As<int>();
     std::cout << "Using random seed: " << random_seed << std::endl;
@@ -183,15 +299,24 @@ public:
     // @CAO - Other options are layout filenames
   }
 
-  void UpdateOrder() {
-    switch (order) {
+  static void UpdateOrder(const QuestionBank & bank, Exam & out_exam, emp::Random & rand,
+                          Order out_order) {
+    switch (out_order) {
     case Order::DEFAULT:    break; // No changes needed
-    case Order::RANDOM:     qbank.Randomize(random); break;
-    case Order::ID:         qbank.SortID();          break;
-    case Order::ALPHABETIC: qbank.SortAlpha();       break;
+    case Order::RANDOM:     bank.Randomize(out_exam, rand); break;
+    case Order::ID:         bank.SortID(out_exam);          break;
+    case Order::ALPHABETIC: bank.SortAlpha(out_exam);       break;
     }
   }
 
+  void UpdateOrder(Exam & out_exam, emp::Random & rand) const {
+    UpdateOrder(qbank, out_exam, rand, order);
+  }
+  void UpdateOrder() {
+    auto timer = stats.Time("order");
+    UpdateOrder(exam, random);
+  }
+
   void PrintVersion() const {
     std::cout << "QBL (Question Bank Language) version " QBL_VERSION << std::endl;
   }
@@ -218,57 +343,418 @@ public:
   }
 
   void LoadFiles() {
-    for (auto filename : question_files) {
-      qbank.NewFile(filename);   // Let the question bank know we are loading from a new file.
-      emp::File file(filename);
-      file.RemoveIfBegins("%");  // Remove all comment lines.
-
-      for (const emp::String & line : file) {
-        if (line.OnlyWhitespace()) { qbank.NewEntry(); continue; }
-        qbank.AddLine(line);
+    auto timer = stats.Time("load");
+
+    // If we have a compiled bank built from these exact files, use it instead of parsing.
+    emp::vector<CacheSource> sources;
+    if (cache_filename.size()) {
+      sources = MakeCacheSources(question_files);
+      if (qbank.LoadCache(cache_filename, sources)) {
+        qbank.IndexTags();
+        return;
       }
+      HashCacheSources(sources);   // Before parsing, so any later edit makes the cache stale.
+    }
+
+    qbank.LoadFiles(question_files, num_threads);
+    qbank.IndexTags();
+
+    if (cache_filename.size() && !qbank.SaveCache(cache_filename, sources)) {
+      emp::notify::Warning("Unable to write compiled question bank '", cache_filename, "'.");
     }
   }
 
-  void Generate() {
-    qbank.Validate();
+  bool IsBatch() const { return variant_count > 0; }
+  bool IsServer() const { return socket_path.size() > 0; }
+
+  // Choose the questions for an exam (or take them all) using the provided random generator.
+  Exam MakeExam(emp::Random & rand) const {
     if (generate_count) {
-      qbank.Generate(generate_count, random, include_tags, exclude_tags, 
-          require_tags, sample_tags, avoid_files);
+      return qbank.Generate(generate_count, rand, include_tags, exclude_tags,
+                            require_tags, sample_tags, avoid_files);
+    }
+    return qbank.MakeExam();
+  }
+
+  void Generate() {
+    {
+      auto timer = stats.Time("validate");
+      qbank.Validate();
+    }
+    auto timer = stats.Time("generate");
+    exam = MakeExam(random);
+    generate_counts += exam.counts;
+  }
+
+  // Seed for a single variant, derived from the main seed and the variant number.  Generating
+  // with this seed directly (-g ... -S seed) reproduces the variant on its own.
+  static int VariantSeed(int main_seed, size_t variant_id) {
+    uint64_t x = static_cast<uint64_t>(main_seed) * 0x9E3779B97F4A7C15ull + variant_id;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;   // splitmix64 finalizer
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return static_cast<int>(x % 2147483646ull) + 1;  // Keep seeds positive.
+  }
+
+  // Fill in the variant number for a filename pattern.  "{}" marks where it goes; otherwise it
+  // is added just before the extension.  Numbers are zero-padded so files sort in order.
+  String VariantName(const String & pattern, size_t variant_id) const {
+    std::string id_str = std::to_string(variant_id);
+    const size_t width = std::to_string(variant_count).size();
+    if (id_str.size() < width) id_str.insert(0, width - id_str.size(), '0');
+
+    std::string name = pattern.str();
+    const size_t mark_pos = name.find("{}");
+    if (mark_pos != std::string::npos) return String(name.replace(mark_pos, 2, id_str));
+
+    const size_t slash_pos = name.rfind('/');
+    size_t dot_pos = name.rfind('.');
+    if (dot_pos == std::string::npos || (slash_pos != std::string::npos && dot_pos < slash_pos)) {
+      dot_pos = name.size();
+    }
+    return String(name.insert(dot_pos, "-" + id_str));
+  }
+
+  // Text formats used when printing in the given output format.
+  static emp::vector<TextFormat> GetTextFormats(Format out_format) {
+    switch (out_format) {
+    case Format::D2L:        return {TextFormat::D2L};
+    case Format::GRADESCOPE: return {TextFormat::RAW, TextFormat::LATEX};
+    case Format::LATEX:      return {TextFormat::LATEX};
+    case Format::WEB:        return {TextFormat::HTML};
+    default:                 return {};
+    }
+  }
+
+  // Text formats used across all outputs, each listed once.
+  emp::vector<TextFormat> GetTextFormats() const {
+    emp::vector<TextFormat> text_formats;
+    for (const Output & output : outputs) {
+      for (TextFormat text_format : GetTextFormats(output.format)) {
+        if (std::find(text_formats.begin(), text_formats.end(), text_format) == text_formats.end()) {
+          text_formats.push_back(text_format);
+        }
+      }
+    }
+    return text_formats;
+  }
+
+  bool HasOutputFile() const { return outputs.size() && outputs[0].base_filename.size(); }
+
+  // Load once, then generate, order, and print every variant with its own seed and log.
+  // Variants share the bank read-only and each has its own random stream and output files, so
+  // they are built in parallel; results do not depend on the number of threads.
+  void GenerateVariants() {
+    if (!HasOutputFile()) {
+      emp::notify::Error("Generating variants requires an output filename pattern (-o).");
+      exit(1);
+    }
+
+    {
+      auto timer = stats.Time("validate");
+      qbank.Validate();
+    }
+
+    // Each variant keeps its own random stream from generation through ordering.
+    const int main_seed = static_cast<int>(random.GetSeed());
+    emp::vector<emp::Random> variant_randoms;
+    variant_randoms.reserve(variant_count);
+    for (size_t i = 0; i < variant_count; ++i) {
+      variant_randoms.emplace_back(VariantSeed(main_seed, i+1));
+    }
+    emp::vector<Exam> exams(variant_count);
+    {
+      auto timer = stats.Time("generate");
+      ParallelFor(variant_count, num_threads,
+                  [&](size_t i){ exams[i] = MakeExam(variant_randoms[i]); });
+      for (const Exam & variant_exam : exams) generate_counts += variant_exam.counts;
+    }
+    {
+      auto timer = stats.Time("order");
+      ParallelFor(variant_count, num_threads,
+                  [&](size_t i){ UpdateOrder(exams[i], variant_randoms[i]); });
+    }
+
+    auto timer = stats.Time("print");
+
+    // Questions shared between variants have their text converted only once.
+    qbank.PrepareRender(exams, GetTextFormats(), num_threads);
+
+    // Names of each variant's files, one per output.
+    emp::vector<emp::vector<String>> out_names(variant_count);
+    emp::vector<String> log_names(variant_count);
+    for (size_t i = 0; i < variant_count; ++i) {
+      for (const Output & output : outputs) {
+        out_names[i].push_back(VariantName(output.base_filename + output.extension, i+1));
+      }
+      if (log_filename.size()) log_names[i] = VariantName(log_filename, i+1);
+    }
+
+    ParallelFor(variant_count, num_threads, [&](size_t i){
+      if (log_names[i].size()) {
+        OutputStream log_file(log_names[i]);
+        qbank.LogQuestions(exams[i], log_file);
+        stats.AddFileBytes(log_names[i], log_file.GetBytesWritten());
+      }
+      // Variants already run in parallel, so each is rendered on a single thread.
+      for (size_t out_id = 0; out_id < outputs.size(); ++out_id) {
+        const String & out_name = out_names[i][out_id];
+        const size_t ext_size = outputs[out_id].extension.size();
+        Print(exams[i], outputs[out_id], out_name.substr(0, out_name.size() - ext_size));
+      }
+    });
+
+    // Report in variant order once everything is written.
+    for (size_t i = 0; i < variant_count; ++i) {
+      std::cout << "Variant " << (i+1) << " (seed " << VariantSeed(main_seed, i+1) << "): ";
+      for (size_t out_id = 0; out_id < outputs.size(); ++out_id) {
+        if (out_id) std::cout << ", ";
+        std::cout << "'" << outputs[out_id].base_path << out_names[i][out_id] << "'";
+      }
+      if (log_names[i].size()) std::cout << ", log '" << log_names[i] << "'";
+      std::cout << ".\n";
+    }
+    std::cout.flush();
+  }
+
+  static bool _ParseNumber(std::string_view text, size_t & value) {
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return text.size() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+  }
+
+  // Answer a single server request.  Requests are one line:
+  //   generate [count=N] [seed=N] [format=F] [order=O] [name=N] [include=TAGS] [exclude=TAGS]
+  //            [require=TAGS] [sample=TAGS]
+  // Anything not given defaults to the command-line settings.  The reply is either
+  // "ERROR message" or "OK seed=S questions=Q size=N" followed by N bytes of output; web
+  // output has three sizes (html,js,css) with the parts sent in that order.
+  std::string HandleRequest(ServedBank & served, std::string_view request) const {
+    auto error = [](std::string_view msg){
+      std::string line(msg);
+      std::replace(line.begin(), line.end(), '\n', ' ');   // Replies are a single line.
+      return "ERROR " + line + "\n";
+    };
+    const QuestionBank & bank = *served.bank;
+
+    emp::vector<std::string_view> words;
+    for (size_t pos = 0; pos < request.size(); ) {
+      const size_t end = std::min(request.find(' ', pos), request.size());
+      if (end > pos) words.push_back(request.substr(pos, end - pos));
+      pos = end + 1;
+    }
+    if (words.empty()) return error("Empty request.");
+    if (words[0] != "generate") return error("Unknown command '" + std::string(words[0]) + "'.");
+
+    size_t count = generate_count;
+    size_t seed = VariantSeed(static_cast<int>(random.GetSeed()), ++request_count);
+    Format out_format = (format == Format::NONE) ? Format::QBL : format;
+    Order out_order = order;
+    bool order_set = false;
+    String name = "exam";
+    emp::vector<String> req_include = include_tags, req_exclude = exclude_tags;
+    emp::vector<String> req_require = require_tags, req_sample = sample_tags;
+
+    for (size_t i = 1; i < words.size(); ++i) {
+      const size_t eq_pos = words[i].find('=');
+      if (eq_pos == std::string_view::npos) {
+        return error("Request arguments must be key=value; found '" + std::string(words[i]) + "'.");
+      }
+      const std::string_view key = words[i].substr(0, eq_pos);
+      const std::string_view value = words[i].substr(eq_pos+1);
+      if (key == "count") {
+        if (!_ParseNumber(value, count)) return error("Invalid count.");
+      } else if (key == "seed") {
+        if (!_ParseNumber(value, seed) || seed == 0 || seed > 2147483647) return error("Invalid seed.");
+      } else if (key == "format") {
+        if (value == "qbl") out_format = Format::QBL;
+        else if (value == "d2l") out_format = Format::D2L;
+        else if (value == "gradescope") out_format = Format::GRADESCOPE;
+        else if (value == "latex") out_format = Format::LATEX;
+        else if (value == "web") out_format = Format::WEB;
+        else return error("Unknown format '" + std::string(value) + "'.");
+      } else if (key == "order") {
+        if (value == "random") out_order = Order::RANDOM;
+        else if (value == "id") out_order = Order::ID;
+        else if (value == "alpha") out_order = Order::ALPHABETIC;
+        else return error("Unknown order '" + std::string(value) + "'.");
+        order_set = true;
+      } else if (key == "name") name = value;
+      else if (key == "include") req_include = String(value).Slice();
+      else if (key == "exclude") req_exclude = String(value).Slice();
+      else if (key == "require") req_require = String(value).Slice();
+      else if (key == "sample") req_sample = String(value).Slice();
+      else return error("Unknown argument '" + std::string(key) + "'.");
+    }
+    // As on the command line, generated exams are shuffled unless an order is given.
+    if (count && !order_set && out_order == Order::DEFAULT) out_order = Order::RANDOM;
+
+    // Problems with the request (such as conflicting tags) fail only this request.
+    ErrorTrap trap;
+    emp::Random request_random(static_cast<int>(seed));
+    Exam out_exam = count ? bank.Generate(count, request_random, req_include, req_exclude,
+                                          req_require, req_sample, avoid_files)
+                          : bank.MakeExam();
+    if (trap.HasError()) return error(trap.GetError().View());
+    UpdateOrder(bank, out_exam, request_random, out_order);
+
+    const String render_error = served.Prepare(out_exam, GetTextFormats(out_format), num_threads);
+    if (render_error.size()) return error(render_error.View());
+
+    emp::vector<std::string> parts(out_format == Format::WEB ? 3 : 1);
+    if (out_format == Format::WEB) {
+      OutputStream html_out(parts[0]), js_out(parts[1]), css_out(parts[2]);
+      PrintWeb(bank, out_exam, name, html_out, js_out, css_out);
+    } else {
+      OutputStream out(parts[0]);
+      Print(bank, out_exam, out_format, out);
+    }
+    if (trap.HasError()) return error(trap.GetError().View());
+
+    std::string response = "OK seed=" + std::to_string(seed)
+                         + " questions=" + std::to_string(out_exam.size()) + " size=";
+    for (size_t i = 0; i < parts.size(); ++i) {
+      if (i) response += ',';
+      response += std::to_string(parts[i].size());
     }
+    response += '\n';
+    for (const std::string & part : parts) response += part;
+    return response;
   }
 
-  void Print(Format out_format, std::ostream & os=std::cout) const {
+  // Keep the bank loaded and answer requests on a Unix socket until a client sends "shutdown".
+  // Question files are watched while serving; when some change, a new bank is built with only
+  // those files parsed again and swapped in whole, so each request sees a single bank.
+  void Serve() {
+    qbank.Validate();
+
+    // The live bank starts as qbank (which outlives the server); reloads replace it.
+    std::atomic<std::shared_ptr<ServedBank>> live_bank{std::make_shared<ServedBank>(
+      std::shared_ptr<QuestionBank>(&qbank, [](QuestionBank *){}))
+    };
+
+    SocketServer server(socket_path, num_threads, [this, &live_bank](std::string_view request){
+      const std::shared_ptr<ServedBank> served = live_bank.load();
+      return HandleRequest(*served, request);
+    });
+    if (!server.Open()) exit(1);
+
+    std::atomic<bool> stop_watching{false};
+    std::thread watch_thread([this, &live_bank, &stop_watching](){
+      FileWatcher watcher(question_files);
+      if (!watcher.IsOK()) {
+        emp::notify::Warning("Unable to watch question files; changes will not be reloaded.");
+        return;
+      }
+      emp::vector<size_t> changed;      // Files changed since the last successful reload.
+      while (!stop_watching) {
+        const emp::vector<size_t> new_changes = watcher.Wait(250);
+        if (new_changes.empty()) continue;
+        for (size_t file_id : new_changes) {
+          if (std::find(changed.begin(), changed.end(), file_id) == changed.end()) {
+            changed.push_back(file_id);
+          }
+        }
+
+        // A bank that fails to load is thrown away; the old one keeps serving until the files
+        // are fixed (changes so far are kept, so they are all picked up then).
+        const std::shared_ptr<ServedBank> old_served = live_bank.load();
+        auto next_bank = std::make_shared<QuestionBank>();
+        {
+          ErrorTrap trap;
+          next_bank->ReloadFrom(*old_served->bank, changed);
+          if (trap.HasError()) {
+            emp::notify::Warning("Unable to reload question files: ", trap.GetError(),
+                                 "  Still serving the previous questions.");
+            continue;
+          }
+        }
+
+        // Copied questions start without converted text, so formats already in use (or being
+        // converted) are converted again before the swap, keeping requests fast.
+        auto next_served = std::make_shared<ServedBank>(next_bank);
+        for (size_t format_id = 0; format_id < NUM_TEXT_FORMATS; ++format_id) {
+          const TextFormat text_format = static_cast<TextFormat>(format_id);
+          if (!old_served->IsRequested(text_format)) continue;
+          next_served->PrepareFormat(text_format, num_threads);
+        }
+        live_bank.store(next_served);
+        std::cout << "Reloaded " << changed.size() << " changed question file(s); "
+                  << next_bank->GetNumQuestions() << " questions now available." << std::endl;
+        changed.clear();
+      }
+    });
+
+    std::cout << "Serving exam requests on '" << socket_path << "'." << std::endl;
+    server.Run();
+    stop_watching = true;
+    watch_thread.join();
+    std::cout << "Server stopped.\n" << server.GetStats().Report();
+    std::cout.flush();
+  }
+
+  void Print(const QuestionBank & bank, const Exam & out_exam, Format out_format,
+             std::ostream & os=std::cout, size_t print_threads=1) const {
     switch (out_format) {
-      case Format::QBL:        qbank.Print(os); break;
-      case Format::NONE:       qbank.Print(os); break;
-      case Format::D2L:        qbank.PrintD2L(os); break;
-      case Format::GRADESCOPE: qbank.PrintGradeScope(os, compressed_format); break;
-      case Format::LATEX:      qbank.PrintLatex(os); break;
+      case Format::QBL:        bank.Print(out_exam, os, print_threads); break;
+      case Format::NONE:       bank.Print(out_exam, os, print_threads); break;
+      case Format::D2L:        bank.PrintD2L(out_exam, os, print_threads); break;
+      case Format::GRADESCOPE:
+        bank.PrintGradeScope(out_exam, os, compressed_format, print_threads);
+        break;
+      case Format::LATEX:      bank.PrintLatex(out_exam, os, print_threads); break;
       case Format::WEB:        emp::notify::Error("Web output must go to files."); break;
-      case Format::DEBUG:      PrintDebug(os); break;
+      case Format::DEBUG:      PrintDebug(bank, out_exam, os); break;
     }
   }
 
-  void Print() const {
+  // Print an exam to one output, named out_base (in the output's base_path), or to standard
+  // out if out_base is empty.  Questions are rendered with up to print_threads threads.
+  void Print(const Exam & out_exam, const Output & output, const String & out_base,
+             size_t print_threads=1) const {
+    // If there is no filename, just print to standard out.
+    if (!out_base.size()) {
+      OutputStream out(STDOUT_FILENO);
+      Print(qbank, out_exam, output.format, out, print_threads);
+      stats.AddFileBytes("(standard output)", out.GetBytesWritten());
+      return;
+    }
+
+    const String main_name = output.base_path + out_base + output.extension;
+    OutputStream main_file(main_name);
+    if (output.format == Format::WEB) {
+      const String js_name = output.base_path + out_base + ".js";
+      const String css_name = output.base_path + out_base + ".css";
+      OutputStream js_file(js_name);
+      OutputStream css_file(css_name);
+      PrintWeb(qbank, out_exam, out_base, main_file, js_file, css_file, print_threads);
+      stats.AddFileBytes(js_name, js_file.GetBytesWritten());
+      stats.AddFileBytes(css_name, css_file.GetBytesWritten());
+    }
+    else Print(qbank, out_exam, output.format, main_file, print_threads);
+    stats.AddFileBytes(main_name, main_file.GetBytesWritten());
+  }
+
+  // Print the exam to every output (and log its question IDs if requested).  All outputs
+  // share the same generated exam.
+  void Print() {
+    auto timer = stats.Time("print");
+
     // If we are supposed to save a log of questions, do so.
     if (log_filename.size()) {
-      qbank.LogQuestions(log_filename);
+      stats.AddFileBytes(log_filename, qbank.LogQuestions(exam, log_filename));
     }
 
-    // If there is no filename, just print to standard out.
-    if (!base_filename.size()) { Print(format); return; }
+    // Convert question text for all outputs at once, so nothing is converted twice.
+    if (outputs.size() > 1) qbank.PrepareRender({exam}, GetTextFormats(), num_threads);
 
-    std::ofstream main_file(base_path + base_filename + extension);
-    if (format == Format::WEB) {
-      std::ofstream js_file(base_path + base_filename + ".js");
-      std::ofstream css_file(base_path + base_filename + ".css");
-      PrintWeb(main_file, js_file, css_file);
+    for (const Output & output : outputs) {
+      Print(exam, output, output.base_filename, num_threads);
     }
-    else Print(format, main_file);
   }
 
-  void PrintWeb(std::ostream & html_out, std::ostream & js_out, std::ostream & css_out) const {
+  void PrintWeb(const QuestionBank & bank, const Exam & out_exam, const String & out_base,
+                std::ostream & html_out, std::ostream & js_out, std::ostream & css_out,
+                size_t print_threads=1) const {
     // Print the header for the HTML file.
     html_out
     << "<!DOCTYPE html>\n"
@@ -277,7 +763,7 @@ public:
     << "  <meta charset=\"UTF-8\">\n"
     << "  <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
     << "  <title>" << title << "</title>\n"
-    << "  <link rel=\"stylesheet\" href=\"" << base_filename << ".css\">\n"
+    << "  <link rel=\"stylesheet\" href=\"" << out_base << ".css\">\n"
     << "</head>\n"
     << "<body>\n"
     << "\n"
@@ -285,7 +771,7 @@ public:
     << "  <h1>" << title << "</h1>\n"
     << "\n";
 
-    qbank.PrintHTML(html_out);
+    bank.PrintHTML(out_exam, html_out, print_threads);
 
     // Print Footer for the HTML file.
     html_out
@@ -296,7 +782,7 @@ public:
     << "  <button type=\"button\" id=\"showAnswersBtn\">Show Answers</button>\n"
     << "</form>\n"
     << "<div id=\"results\"></div>\n"
-    << "<script src=\"" << base_filename << ".js\"></script>\n"
+    << "<script src=\"" << out_base << ".js\"></script>\n"
     << "</body>\n"
     << "</html>\n";
 
@@ -323,7 +809,7 @@ public:
     << "  event.preventDefault(); // Prevent form from submitting to a server\n"
     << "  let correctAnswers = {\n";
 
-    qbank.PrintJS(js_out);
+    bank.PrintJS(out_exam, js_out);
 
     // Print Footer for the JS file.
     js_out
@@ -426,17 +912,34 @@ public:
     << "}\n";
   }
 
-  void PrintDebug(std::ostream & os=std::cout) const {
-   os << "Question Files: " << emp::MakeLiteral(question_files) << "\n"
-      << "Base filename: " << base_filename << "\n"
-      << "... extension: " << extension << "\n"
-      << "Output Format: " << GetFormatName(format) << "\n"
-      << "Include tags: " << emp::MakeLiteral(include_tags) << "\n"
+  // Print the statistics for this run to standard error, if they were requested.
+  void ReportStats() {
+    if (stats_format.empty()) return;
+    stats.SetCounter("lines_parsed", qbank.GetLinesParsed());
+    stats.SetCounter("questions_multiple_choice", qbank.CountQuestions(QType::MULTIPLE_CHOICE));
+    stats.SetCounter("questions_short_answer", qbank.CountQuestions(QType::SHORT_ANSWER));
+    stats.SetCounter("tags_interned", qbank.GetNumTags());
+    stats.SetCounter("rejected_question_draws", generate_counts.rejected_draws);
+    stats.SetCounter("repeated_option_draws", generate_counts.option_collisions);
+    stats.SetCounter("exclusive_group_conflicts", generate_counts.group_conflicts);
+    if (stats_format == "json") stats.PrintJSON(std::cerr);
+    else stats.PrintText(std::cerr);
+  }
+
+  void PrintDebug(const QuestionBank & bank, const Exam & out_exam,
+                  std::ostream & os=std::cout) const {
+   os << "Question Files: " << emp::MakeLiteral(question_files) << "\n";
+   for (const Output & output : outputs) {
+     os << "Base filename: " << output.base_filename << "\n"
+        << "... extension: " << output.extension << "\n"
+        << "Output Format: " << GetFormatName(output.format) << "\n";
+   }
+   os << "Include tags: " << emp::MakeLiteral(include_tags) << "\n"
       << "Exclude tags: " << emp::MakeLiteral(exclude_tags) << "\n"
       << "Required tags: " << emp::MakeLiteral(require_tags) << "\n"
       << "Sampled tags: " << emp::MakeLiteral(sample_tags) << "\n"
       << "----------\n";
-    qbank.PrintDebug(os);
+    bank.PrintDebug(out_exam, os);
   }
 };
 
@@ -451,7 +954,12 @@ int main(int argc, char * argv[])
   }
   QBL qbl(argc, argv);
   qbl.LoadFiles();
-  qbl.Generate();
-  qbl.UpdateOrder();
-  qbl.Print();
+  if (qbl.IsServer()) qbl.Serve();
+  else if (qbl.IsBatch()) qbl.GenerateVariants();
+  else {
+    qbl.Generate();
+    qbl.UpdateOrder();
+    qbl.Print();
+  }
+  qbl.ReportStats();
 }
@@ -0,0 +1,427 @@
+// Benchmarks for QBL: build a synthetic question bank and time each phase of making an exam
+// from it (loading, validation, generation with various tag filters, and every output format).
+//
+// Each result is also written on its own line as "name seconds questions bytes", so a saved
+// run can be given back with --baseline to compare against later runs.  Heap allocations are
+// counted too, for loading a bank, converting its text, and releasing it.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "emp/base/vector.hpp"
+#include "emp/config/FlagManager.hpp"
+#include "emp/math/Random.hpp"
+#include "emp/tools/String.hpp"
+
+#include "BankGenerator.hpp"
+#include "CacheIO.hpp"
+#include "Exam.hpp"
+#include "OutputStream.hpp"
+#include "parallel.hpp"
+#include "QuestionBank.hpp"
+
+using emp::String;
+
+// Count every heap allocation made by the program.  The replacements are kept out of line so
+// that the compiler does not pair an inlined free() with a call to new and warn about it.
+static std::atomic<size_t> alloc_count{0};
+static std::atomic<size_t> free_count{0};
+
+[[gnu::noinline]] void * operator new(size_t size) {
+  alloc_count.fetch_add(1, std::memory_order_relaxed);
+  if (void * ptr = std::malloc(size ? size : 1)) return ptr;
+  throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void * ptr) noexcept {
+  if (ptr) free_count.fetch_add(1, std::memory_order_relaxed);
+  std::free(ptr);
+}
+[[gnu::noinline]] void operator delete(void * ptr, size_t) noexcept { operator delete(ptr); }
+
+class QBLBench {
+private:
+  struct Result {
+    std::string name;
+    double seconds;                   // Best time over all repeats.
+    size_t questions;                 // Questions handled in one repeat.
+    size_t bytes;                     // Bytes read or written in one repeat.
+  };
+
+  struct AllocResult {
+    std::string name;
+    size_t allocs;                    // Heap allocations made.
+    size_t frees;                     // Heap allocations released.
+    size_t questions;                 // Questions handled.
+  };
+
+  // Loading or releasing a bank should make only a handful of allocations, for large blocks
+  // (question pools and text arenas) and per-tag indexes, not several for every question.
+  static constexpr size_t MAX_BANK_ALLOCS = 1000;         // Allowance for a whole bank...
+  static constexpr double MAX_ALLOCS_PER_QUESTION = 0.05; // ...plus this much per question.
+
+  emp::FlagManager flags;
+  BankSettings settings;
+  size_t num_files = 4;               // Number of files to split the bank across.
+  size_t num_threads = DefaultThreadCount();
+  size_t repeat_count = 3;            // Times to run each benchmark (the best is reported).
+  size_t exam_size = 100;             // Questions on each generated exam.
+  size_t exams_per_repeat = 20;       // Exams generated per timed repeat.
+  String output_filename = "";        // Where to save results (if anywhere).
+  String baseline_filename = "";      // Earlier results to compare against (if any).
+  String cache_filename = "";         // Compiled bank (written while timing loads).
+
+  std::filesystem::path bank_dir;     // Temporary directory holding the bank files.
+  size_t bank_bytes = 0;              // Total size of all bank files.
+  emp::vector<Result> results;
+  emp::vector<AllocResult> alloc_results;
+
+  template <typename FUN_T>
+  double _TimeBest(FUN_T && fun) const {
+    double best = 0.0;
+    for (size_t rep = 0; rep < repeat_count; ++rep) {
+      const auto start_time = std::chrono::steady_clock::now();
+      fun();
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+      if (rep == 0 || elapsed.count() < best) best = elapsed.count();
+    }
+    return best;
+  }
+
+  // Write a synthetic bank to disk, split across files; return the filenames and add the
+  // number of bytes written to total_bytes.
+  emp::vector<String> _WriteBank(const BankSettings & bank_settings, const std::string & name,
+                                 size_t & total_bytes) {
+    emp::vector<String> filenames;
+    const size_t file_count = std::max<size_t>(num_files, 1);
+    for (size_t file_id = 0; file_id < file_count; ++file_id) {
+      BankSettings file_settings = bank_settings;
+      file_settings.num_questions = bank_settings.num_questions / file_count
+                                  + (file_id < bank_settings.num_questions % file_count);
+      file_settings.seed = bank_settings.seed + static_cast<int>(file_id);
+      const std::string text = BankGenerator(file_settings).Generate();
+      const std::filesystem::path path = bank_dir / (name + std::to_string(file_id) + ".qbl");
+      filenames.push_back(String(path.string()));
+      OutputStream(filenames.back()) << text;
+      total_bytes += text.size();
+    }
+    return filenames;
+  }
+
+  static void _LoadBank(QuestionBank & bank, const emp::vector<String> & files, size_t threads) {
+    bank.LoadFiles(files, threads);
+    bank.IndexTags();
+  }
+
+  void _Record(const std::string & name, double seconds, size_t questions, size_t bytes) {
+    results.push_back(Result{name, seconds, questions, bytes});
+  }
+
+  void _BenchLoad(const emp::vector<String> & files) {
+    size_t num_questions = 0;
+    for (size_t threads : {size_t{1}, num_threads}) {
+      const double seconds = _TimeBest([&](){
+        QuestionBank bank;
+        _LoadBank(bank, files, threads);
+        num_questions = bank.GetNumQuestions();
+      });
+      _Record(threads == 1 ? "load_serial" : "load_parallel", seconds, num_questions, bank_bytes);
+      if (num_threads == 1) break;
+    }
+
+    // Load the same bank from a compiled cache.  The bank files are aged first; a cache does
+    // not trust the modification time of files changed in the last few seconds, and hashes them.
+    const auto old_time = std::filesystem::file_time_type::clock::now() - std::chrono::hours(1);
+    for (const String & filename : files) {
+      std::filesystem::last_write_time(std::string(filename.begin(), filename.end()), old_time);
+    }
+    cache_filename = String((bank_dir / "bank.qblc").string());
+    {
+      QuestionBank bank;
+      emp::vector<CacheSource> sources = MakeCacheSources(files);
+      HashCacheSources(sources);
+      _LoadBank(bank, files, num_threads);
+      bank.SaveCache(cache_filename, sources);
+    }
+    const double seconds = _TimeBest([&](){
+      QuestionBank bank;
+      emp::vector<CacheSource> sources = MakeCacheSources(files);
+      if (bank.LoadCache(cache_filename, sources)) bank.IndexTags();
+      num_questions = bank.GetNumQuestions();
+    });
+    const size_t cache_bytes = std::filesystem::file_size(bank_dir / "bank.qblc");
+    _Record("load_cache", seconds, num_questions, cache_bytes);
+  }
+
+  // Count the allocations made while loading a bank (from question files and from the cache)
+  // and converting all of its text for output, and the allocations released along with the
+  // bank.  Exits with an error if loading or releasing a bank takes more allocations than
+  // MAX_BANK_ALLOCS plus MAX_ALLOCS_PER_QUESTION for each question.
+  void _BenchAllocs(const emp::vector<String> & files) {
+    auto record = [this](const std::string & name, size_t questions, bool check, auto && fun){
+      const size_t start_allocs = alloc_count.load();
+      const size_t start_frees = free_count.load();
+      fun();
+      const AllocResult result{name, alloc_count.load() - start_allocs,
+                               free_count.load() - start_frees, questions};
+      alloc_results.push_back(result);
+      const double limit = MAX_BANK_ALLOCS + MAX_ALLOCS_PER_QUESTION * questions;
+      if (check && static_cast<double>(std::max(result.allocs, result.frees)) > limit) {
+        std::cerr << "ERROR: " << name << " made " << result.allocs << " allocations and "
+                  << result.frees << " frees for " << questions << " questions." << std::endl;
+        std::exit(1);
+      }
+    };
+
+    for (bool from_cache : {false, true}) {
+      const std::string source = from_cache ? "cache" : "serial";
+      auto bank = std::make_unique<QuestionBank>();
+      emp::vector<CacheSource> sources = MakeCacheSources(files);
+      record("load_" + source, settings.num_questions, true, [&](){
+        if (!from_cache) _LoadBank(*bank, files, 1);
+        else if (bank->LoadCache(cache_filename, sources)) bank->IndexTags();
+      });
+      if (from_cache) {
+        record("render_latex", settings.num_questions, false,
+               [&](){ bank->TryPrepareRender(TextFormat::LATEX, num_threads); });
+      }
+      record("release_" + source, settings.num_questions, true, [&](){ bank.reset(); });
+    }
+  }
+
+  // Time reloading a bank after its first file changes, while another thread converts the old
+  // bank's text for a format no request has used yet (as a server does for a new request).  The
+  // reloaded bank must print exactly like a freshly loaded one; exits with an error if not.
+  void _BenchReload(const emp::vector<String> & files) {
+    std::string expected;
+    {
+      QuestionBank fresh;
+      _LoadBank(fresh, files, num_threads);
+      OutputStream os(expected);
+      fresh.PrintLatex(fresh.MakeExam(), os);
+    }
+
+    double best = 0.0;
+    size_t num_questions = 0;
+    for (size_t rep = 0; rep < repeat_count; ++rep) {
+      QuestionBank old_bank;
+      _LoadBank(old_bank, files, num_threads);
+      QuestionBank new_bank;
+      std::thread converter([&old_bank](){ old_bank.TryPrepareRender(TextFormat::LATEX); });
+      const auto start_time = std::chrono::steady_clock::now();
+      new_bank.ReloadFrom(old_bank, {0});
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+      converter.join();
+      if (rep == 0 || elapsed.count() < best) best = elapsed.count();
+      num_questions = new_bank.GetNumQuestions();
+
+      new_bank.TryPrepareRender(TextFormat::LATEX, num_threads);
+      std::string reloaded;
+      {
+        OutputStream os(reloaded);
+        new_bank.PrintLatex(new_bank.MakeExam(), os);
+      }
+      if (reloaded != expected) {
+        std::cerr << "ERROR: Bank reloaded during text conversion prints differently from a "
+                     "freshly loaded bank." << std::endl;
+        std::exit(1);
+      }
+    }
+    _Record("reload", best, num_questions, 0);
+  }
+
+  void _BenchGenerate(const QuestionBank & bank, const std::string & name,
+                      const emp::vector<String> & include_tags,
+                      const emp::vector<String> & exclude_tags,
+                      const emp::vector<String> & require_tags,
+                      const emp::vector<String> & sample_tags) {
+    size_t num_questions = 0;
+    const double seconds = _TimeBest([&](){
+      num_questions = 0;
+      for (size_t exam_id = 0; exam_id < exams_per_repeat; ++exam_id) {
+        emp::Random random(settings.seed + static_cast<int>(exam_id));
+        const Exam exam = bank.Generate(exam_size, random, include_tags, exclude_tags,
+                                        require_tags, sample_tags, {});
+        num_questions += exam.size();
+      }
+    });
+    _Record("generate_" + name, seconds, num_questions, 0);
+  }
+
+  template <typename FUN_T>
+  void _BenchPrint(const std::string & name, const Exam & exam, FUN_T && print) {
+    size_t num_bytes = 0;
+    const double seconds = _TimeBest([&](){
+      std::string text;
+      {
+        OutputStream os(text);
+        print(os);
+      }
+      num_bytes = text.size();
+    });
+    _Record("print_" + name, seconds, exam.size(), num_bytes);
+  }
+
+  // Load results saved by an earlier run, by benchmark name.
+  std::map<std::string, double> _LoadBaseline() const {
+    std::map<std::string, double> baseline;
+    if (baseline_filename.empty()) return baseline;
+    std::ifstream file(std::string(baseline_filename.begin(), baseline_filename.end()));
+    if (!file) {
+      emp::notify::Warning("Unable to read baseline file '", baseline_filename, "'.");
+      return baseline;
+    }
+    std::string name;
+    double seconds;
+    size_t questions, bytes;
+    while (file >> name >> seconds >> questions >> bytes) baseline[name] = seconds;
+    return baseline;
+  }
+
+  void _Report() const {
+    const auto baseline = _LoadBaseline();
+    std::cout << std::left << std::setw(24) << "benchmark" << std::right
+              << std::setw(12) << "time_ms" << std::setw(16) << "questions/s"
+              << std::setw(12) << "MB/s";
+    if (baseline.size()) std::cout << std::setw(12) << "speedup";
+    std::cout << '\n' << std::fixed;
+    for (const Result & result : results) {
+      const double seconds = std::max(result.seconds, 1e-9);
+      std::cout << std::left << std::setw(24) << result.name << std::right
+                << std::setprecision(3) << std::setw(12) << result.seconds * 1000.0
+                << std::setprecision(0) << std::setw(16) << result.questions / seconds
+                << std::setprecision(2) << std::setw(12) << result.bytes / seconds / 1e6;
+      if (auto it = baseline.find(result.name); it != baseline.end()) {
+        std::cout << std::setw(11) << it->second / seconds << 'x';
+      }
+      std::cout << '\n';
+    }
+
+    std::cout << '\n' << std::left << std::setw(24) << "allocations" << std::right
+              << std::setw(12) << "allocs" << std::setw(12) << "frees"
+              << std::setw(16) << "per question" << '\n';
+    for (const AllocResult & result : alloc_results) {
+      const size_t most = std::max(result.allocs, result.frees);
+      std::cout << std::left << std::setw(24) << result.name << std::right
+                << std::setw(12) << result.allocs << std::setw(12) << result.frees
+                << std::setprecision(4) << std::setw(16)
+                << static_cast<double>(most) / std::max<size_t>(result.questions, 1) << '\n';
+    }
+
+    if (output_filename.size()) {
+      OutputStream os(output_filename);
+      os << std::setprecision(9);
+      for (const Result & result : results) {
+        os << result.name << ' ' << result.seconds << ' '
+           << result.questions << ' ' << result.bytes << '\n';
+      }
+    }
+  }
+
+public:
+  QBLBench(int argc, char * argv[]) : flags(argc, argv) {
+    settings.num_questions = 20000;
+    flags.AddOption('n', "--questions",
+      [this](String arg){ settings.num_questions = arg.As<size_t>(); },
+      "Number of questions in the synthetic bank (default 20000).");
+    flags.AddOption('f', "--files", [this](String arg){ num_files = arg.As<size_t>(); },
+      "Number of files to split the bank across (default 4).");
+    flags.AddOption('T', "--tags",
+      [this](String arg){ settings.tags_per_question = arg.As<size_t>(); },
+      "Number of # tags on each question (default 3).");
+    flags.AddOption('G', "--groups",
+      [this](String arg){ settings.group_density = arg.As<double>(); },
+      "Fraction of questions in a ^ group (default 0.2).");
+    flags.AddOption('O', "--options",
+      [this](String arg){ settings.max_options = arg.As<size_t>(); },
+      "Most options on a multiple-choice question (default 8).");
+    flags.AddOption('c', "--code", [this](String arg){ settings.code_density = arg.As<double>(); },
+      "Fraction of questions with a code block (default 0.1).");
+    flags.AddOption('e', "--escapes",
+      [this](String arg){ settings.escape_density = arg.As<double>(); },
+      "Fraction of words that need escaping or markup (default 0.05).");
+    flags.AddOption('S', "--seed", [this](String arg){ settings.seed = arg.As<int>(); },
+      "Random number seed for the bank and exams (default 1).");
+    flags.AddOption('j', "--threads",
+      [this](String arg){ num_threads = std::max<size_t>(arg.As<size_t>(), 1); },
+      "Threads for parallel loading and printing (default: all available cores).");
+    flags.AddOption('r', "--repeat",
+      [this](String arg){ repeat_count = std::max<size_t>(arg.As<size_t>(), 1); },
+      "Run each benchmark [arg] times and report the best (default 3).");
+    flags.AddOption('g', "--generate", [this](String arg){ exam_size = arg.As<size_t>(); },
+      "Number of questions on each generated exam (default 100).");
+    flags.AddOption('o', "--output", [this](String arg){ output_filename = arg; },
+      "Save results to file [arg], for use as a later baseline.");
+    flags.AddOption('b', "--baseline", [this](String arg){ baseline_filename = arg; },
+      "Compare against results saved in file [arg].");
+    flags.AddOption('h', "--help", [this](){ flags.PrintOptions(); std::exit(0); },
+      "Provide usage information for QBL_bench (this message).");
+    flags.Process();
+    settings.min_options = std::min(settings.min_options, settings.max_options);
+  }
+
+  void Run() {
+    bank_dir = std::filesystem::temp_directory_path()
+             / ("qbl_bench_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(bank_dir);
+    const emp::vector<String> files = _WriteBank(settings, "bank", bank_bytes);
+
+    // Web output expects exactly one correct answer per question, so measure it on a bank
+    // built to match (otherwise every question would print a warning).
+    BankSettings web_settings = settings;
+    web_settings.max_correct = 1;
+    web_settings.short_answer_density = 0.0;
+    size_t web_bytes = 0;
+    const emp::vector<String> web_files = _WriteBank(web_settings, "web", web_bytes);
+
+    _BenchLoad(files);
+    _BenchAllocs(files);
+    _BenchReload(files);
+
+    QuestionBank bank;
+    _LoadBank(bank, files, num_threads);
+    _Record("validate", _TimeBest([&bank](){ bank.Validate(); }), bank.GetNumQuestions(), 0);
+
+    _BenchGenerate(bank, "all", {}, {}, {}, {});
+    _BenchGenerate(bank, "include", {"#t0"}, {}, {}, {});   // #t0 is never in a group.
+    _BenchGenerate(bank, "exclude", {}, {"#t2", "#t3", "#t4"}, {}, {});
+    _BenchGenerate(bank, "require", {}, {}, {"#t5"}, {});
+    _BenchGenerate(bank, "sample", {}, {}, {}, {"#t9", "#t10", "#t11"});
+
+    const Exam exam = bank.MakeExam();
+    const size_t threads = num_threads;
+    _BenchPrint("qbl", exam, [&](std::ostream & os){ bank.Print(exam, os, threads); });
+    _BenchPrint("d2l", exam, [&](std::ostream & os){ bank.PrintD2L(exam, os, threads); });
+    _BenchPrint("gradescope", exam,
+                [&](std::ostream & os){ bank.PrintGradeScope(exam, os, false, threads); });
+    _BenchPrint("html", exam, [&](std::ostream & os){ bank.PrintHTML(exam, os, threads); });
+    _BenchPrint("latex", exam, [&](std::ostream & os){ bank.PrintLatex(exam, os, threads); });
+
+    QuestionBank web_bank;
+    _LoadBank(web_bank, web_files, num_threads);
+    web_bank.Validate();
+    const Exam web_exam = web_bank.MakeExam();
+    _BenchPrint("js", web_exam, [&](std::ostream & os){ web_bank.PrintJS(web_exam, os); });
+
+    std::filesystem::remove_all(bank_dir);
+    _Report();
+  }
+};
+
+int main(int argc, char * argv[])
+{
+  QBLBench bench(argc, argv);
+  bench.Run();
+}
@@ -1,10 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cctype>
 #include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
 
 #include "emp/base/notify.hpp"
+#include "emp/base/Ptr.hpp"
 #include "emp/base/vector.hpp"
-#include "emp/datastructs/map_utils.hpp"
 #include "emp/datastructs/vector_utils.hpp"
 #include "emp/io/File.hpp"
 #include "emp/math/Random.hpp"
@@ -12,26 +18,73 @@
 #include "emp/math/Range.hpp"
 #include "emp/tools/String.hpp"
 
+#include "CacheIO.hpp"
+#include "errors.hpp"
+#include "Exam.hpp"
 #include "functions.hpp"
+#include "TagDictionary.hpp"
+#include "TextArena.hpp"
 
 using emp::String;
 
+// Types of questions that QBL can manage.
+enum class QType {
+  UNKNOWN = 0,
+  MULTIPLE_CHOICE,
+  SHORT_ANSWER
+};
+
+// Text of the question currently being parsed.  Text arrives a line at a time, so it is
+// built up here and copied into the bank's arena once the question is complete.  A bank keeps
+// a single draft for all of its questions, so these buffers rarely need to grow.
+struct QuestionDraft {
+  std::string question;
+  std::string alt_question;
+  std::string explanation;
+  std::string tag_text;
+  std::string option_text;
+  std::string option_feedback;
+  emp::vector<uint32_t> text_ends;
+  emp::vector<uint32_t> feedback_ends;
+
+  void Clear() {
+    question.clear();
+    alt_question.clear();
+    explanation.clear();
+    tag_text.clear();
+    option_text.clear();
+    option_feedback.clear();
+    text_ends.clear();
+    feedback_ends.clear();
+  }
+};
+
 class Question {
 protected:
-  size_t id = (size_t) -1;      ///< Unique ID for this question.
-  emp::String question;         ///< Wording for this question.
-  emp::String alt_question;     ///< Toggled wording for this question.
-  emp::String explanation;      ///< Explain this question to the student (usually reveals answer)
-  emp::String hint;             ///< Hint to point students in the right direction.
+  // Text refers to storage owned by the bank (see TextArena), or to the draft while the
+  // question is being parsed, so a question does not allocate any text of its own.
+  size_t id = (size_t) -1;        ///< Unique ID for this question.
+  QType type = QType::UNKNOWN;    ///< Kind of question (set by the derived class).
+  std::string_view question;      ///< Wording for this question.
+  std::string_view alt_question;  ///< Toggled wording for this question.
+  std::string_view explanation;   ///< Explain this question to the student (usually reveals answer)
+  std::string_view hint;          ///< Hint to point students in the right direction.
+  std::string_view tag_text;      ///< All tags (topic, exclusive, and config), space separated.
+
+  // Text of each option (answer options or accepted answers), stored back to back.
+  std::string_view option_text;         ///< Wording for all options, one after another.
+  std::span<const uint32_t> text_ends;  ///< Position in option_text where each option ends.
 
-  emp::vector<String> base_tags;       ///< Tags to identify topic.
-  emp::vector<String> exclusive_tags;  ///< Tags for question groups where only one should be used.
-  std::map<String,String> config_tags; ///< Tags to specify question details (num options, etc)
+  using tag_id_t = TagDictionary::tag_id_t;
+  std::span<const tag_id_t> tag_ids;        ///< Sorted IDs of ALL tags (set by bank).
+  std::span<const tag_id_t> exclusive_ids;  ///< IDs of exclusive tags only.
+  bool tags_indexed = false;                ///< Have tag_ids been set?
+
+  emp::Ptr<QuestionDraft> draft = nullptr;  ///< Where text is being built (while parsing only).
 
   size_t points = 1;          ///< How many points should this question be worth?
   bool is_required = false;   ///< Must this question be used on a generated quiz?
   bool is_fixed = false;      ///< Is this question locked into this order?
-  size_t avoid = 0;           ///< How many times should we skip this question before picking it?
 
   // Which section are we currently loading in?  Needed for multi-line entries.
   enum class Section {
@@ -43,10 +96,88 @@ protected:
   };
   Section last_edit = Section::NONE;
 
+  // Text converted for one output format; filled in by PrepareRender() and only read while
+  // printing, so a prepared question can be printed from several threads at once.  Copying a
+  // question starts it with an empty cache: the original may be filling its own on another
+  // thread (as a served bank does while a reload copies from it), so it must not be read.
+  struct RenderCache {
+    bool ready = false;
+    std::string_view question;
+    std::string_view alt_question;
+    std::span<const std::string_view> options;
+
+    RenderCache() = default;
+    RenderCache(const RenderCache &) { }
+    RenderCache(RenderCache &&) = default;
+    RenderCache & operator=(const RenderCache &) { return *this = RenderCache{}; }
+    RenderCache & operator=(RenderCache &&) = default;
+  };
+  std::array<RenderCache, NUM_TEXT_FORMATS> render_cache;
+
+  // Raw text is only used to measure whole entries, so newlines are not special there.
+  static emp::String _RenderText(std::string_view text, TextFormat format) {
+    return TextToFormat(text, format, format != TextFormat::RAW);
+  }
+  static std::string_view _RenderText(std::string_view text, TextFormat format,
+                                      MarkupScratch & scratch) {
+    return TextToFormat(text, format, format != TextFormat::RAW, scratch);
+  }
+
+  // Access the text of each option (by position).
+  size_t _CountOptionTexts() const { return text_ends.size(); }
+  std::string_view _GetOptionText(size_t opt_id) const {
+    return _Slice(option_text, text_ends, opt_id);
+  }
+  static std::string_view _Slice(std::string_view pool, std::span<const uint32_t> ends,
+                                 size_t opt_id) {
+    const size_t start = opt_id ? ends[opt_id-1] : 0;
+    return pool.substr(start, ends[opt_id] - start);
+  }
+
+  // Can ends (as loaded from a cache) be used to slice a pool of the given size?
+  static bool _EndsFit(std::span<const uint32_t> ends, size_t pool_size) {
+    return std::is_sorted(ends.begin(), ends.end()) && (ends.empty() || ends.back() <= pool_size);
+  }
+
+  // Point all text at the draft; needed after each change, since its buffers may move.
+  void _ViewDraft() {
+    question = draft->question;
+    alt_question = draft->alt_question;
+    explanation = draft->explanation;
+    tag_text = draft->tag_text;
+    option_text = draft->option_text;
+    text_ends = draft->text_ends;
+  }
+
+  // Append the text of a new option to the draft.
+  void _PushOptionText(std::string_view text) {
+    draft->option_text.append(text);
+    draft->text_ends.push_back(static_cast<uint32_t>(draft->option_text.size()));
+    _ViewDraft();
+  }
+
+  // Call fun on each tag (as written), in order.
+  template <typename FUN_T>
+  void _ForEachTag(FUN_T && fun) const {
+    for (size_t pos = 0; pos < tag_text.size(); ) {
+      const size_t end = std::min(tag_text.find(' ', pos), tag_text.size());
+      fun(tag_text.substr(pos, end - pos));
+      pos = end + 1;
+    }
+  }
+
+  // Value of a config tag (":name=value"); if a tag is set more than once, the last one wins.
   template <typename T>
-  T _GetConfig(String name, T default_val=T{}) const {
-    if (!emp::Has(config_tags, name)) return default_val;
-    const String & val = config_tags.find(name)->second;
+  T _GetConfig(std::string_view name, T default_val=T{}) const {
+    bool found = false;
+    std::string_view value;
+    _ForEachTag([name, &found, &value](std::string_view tag){
+      if (tag.size() <= name.size() || tag[name.size()] != '=' || !tag.starts_with(name)) return;
+      found = true;
+      value = tag.substr(name.size() + 1);
+    });
+    if (!found) return default_val;
+    const String val(value);
 
     // Ranges should allow a dash.
     if constexpr (std::is_same_v<T,emp::Range<size_t>>) {
@@ -74,8 +205,7 @@ protected:
 
   template <typename... Ts>
   void _Error(Ts &&... args) const {
-    emp::notify::Error("Question ", id, " (", question, ")", ": ",
-                        std::forward<Ts>(args)...);
+    ReportError("Question ", id, " (", question, ")", ": ", std::forward<Ts>(args)...);
   }
 
   template <typename... Ts>
@@ -84,9 +214,47 @@ protected:
     return test;
   }
 
+  // Save or load the information common to all question types.  Tags must already be indexed;
+  // the cache stores the tag IDs directly, so a loaded question needs no indexing.  Loaded text
+  // is placed in the reader's arena.
+  void _SaveBase(CacheWriter & out) const {
+    emp_assert(tags_indexed);
+    out.Write<uint64_t>(id);
+    out.Write(question);
+    out.Write(alt_question);
+    out.Write(explanation);
+    out.Write(hint);
+    out.Write(tag_text);
+    out.WriteArray(tag_ids);
+    out.WriteArray(exclusive_ids);
+    out.Write(option_text);
+    out.WriteArray(text_ends);
+    out.Write<uint64_t>(points);
+    out.Write(is_required);
+    out.Write(is_fixed);
+  }
+
+  void _LoadBase(CacheReader & in) {
+    id = in.Read<uint64_t>();
+    question = in.ReadText();
+    alt_question = in.ReadText();
+    explanation = in.ReadText();
+    hint = in.ReadText();
+    tag_text = in.ReadText();
+    tag_ids = in.ReadTagIDs();
+    exclusive_ids = in.ReadTagIDs();
+    option_text = in.ReadText();
+    text_ends = in.ReadArray<uint32_t>();
+    points = in.Read<uint64_t>();
+    is_required = in.Read<bool>();
+    is_fixed = in.Read<bool>();
+    tags_indexed = true;
+    if (!_EndsFit(text_ends, option_text.size())) in.SetError();
+  }
+
 public:
-  Question() { }
-  Question(size_t id) : id(id) { }       ///< Constructor that specified ID.
+  Question(QType type) : type(type) { }
+  Question(QType type, size_t id) : id(id), type(type) { }  ///< Constructor that specified ID.
   Question(const Question &) = default;  ///< Copy Constructor
   Question(Question &&) = default;       ///< Move Constructor
   virtual ~Question() { }
@@ -95,10 +263,85 @@ public:
   Question & operator=(Question &&) = default;
 
   size_t GetID() const { return id; }
-  const emp::String & GetQuestion() const { return question; }
-  const emp::String & GetAltQuestion() const { return alt_question; }
-  const emp::String & GetExplanation() const { return explanation; }
-  const emp::String & GetHint() const { return hint; }
+  QType GetType() const { return type; }  // Stored, so dispatch on type needs no virtual call.
+  void SetID(size_t _id) { id = _id; }
+  std::string_view GetQuestion() const { return question; }
+  std::string_view GetAltQuestion() const { return alt_question; }
+  std::string_view GetExplanation() const { return explanation; }
+  std::string_view GetHint() const { return hint; }
+
+  // Wording to use for this question with the provided layout.
+  std::string_view GetQuestion(const QuestionLayout & layout) const {
+    return layout.use_alt ? alt_question : question;
+  }
+
+  // Begin building this question's text in a draft (continuing from any text it already has).
+  virtual void StartDraft(QuestionDraft & in_draft) {
+    if (draft == &in_draft) return;
+    in_draft.Clear();
+    in_draft.question = question;
+    in_draft.alt_question = alt_question;
+    in_draft.explanation = explanation;
+    in_draft.tag_text = tag_text;
+    in_draft.option_text = option_text;
+    in_draft.text_ends.assign(text_ends.begin(), text_ends.end());
+    draft = &in_draft;
+    _ViewDraft();
+  }
+
+  // Once parsing is done, move the text from the draft into its permanent home.
+  virtual void FinishDraft(TextArena & arena) {
+    question = arena.AddText(draft->question);
+    alt_question = arena.AddText(draft->alt_question);
+    explanation = arena.AddText(draft->explanation);
+    tag_text = arena.AddText(draft->tag_text);
+    option_text = arena.AddText(draft->option_text);
+    text_ends = arena.AddArray(draft->text_ends);
+    draft = nullptr;
+  }
+
+  // Copy all text into another arena (as when a question is copied into a new bank).
+  virtual void CopyTextTo(TextArena & arena) {
+    question = arena.AddText(question);
+    alt_question = arena.AddText(alt_question);
+    explanation = arena.AddText(explanation);
+    hint = arena.AddText(hint);
+    tag_text = arena.AddText(tag_text);
+    option_text = arena.AddText(option_text);
+    text_ends = arena.AddArray(text_ends.data(), text_ends.size());
+    tag_ids = arena.AddArray(tag_ids.data(), tag_ids.size());
+    exclusive_ids = arena.AddArray(exclusive_ids.data(), exclusive_ids.size());
+  }
+
+  // Convert all of this question's text for a format ahead of time, so that printing it any
+  // number of times (such as across exam variants) reuses the result.  Converted text is
+  // stored in the provided arena, and scratch is reused for each conversion.
+  void PrepareRender(TextFormat format, TextArena & arena, MarkupScratch & scratch) {
+    RenderCache & cache = render_cache[static_cast<size_t>(format)];
+    if (cache.ready) return;
+    cache.question = arena.AddText(_RenderText(question, format, scratch));
+    cache.alt_question = arena.AddText(_RenderText(alt_question, format, scratch));
+    std::span<std::string_view> options = arena.NewArray<std::string_view>(_CountOptionTexts());
+    for (size_t i = 0; i < options.size(); ++i) {
+      options[i] = arena.AddText(_RenderText(_GetOptionText(i), format, scratch));
+    }
+    cache.options = options;
+    cache.ready = true;
+  }
+
+  // Wording for a layout converted to a format (from the cache, if prepared).
+  RenderedText RenderQuestion(const QuestionLayout & layout, TextFormat format) const {
+    const RenderCache & cache = render_cache[static_cast<size_t>(format)];
+    if (cache.ready) return layout.use_alt ? cache.alt_question : cache.question;
+    return _RenderText(GetQuestion(layout), format);
+  }
+
+  // Text of an answer option converted to a format (from the cache, if prepared).
+  RenderedText RenderOption(size_t opt_id, TextFormat format) const {
+    const RenderCache & cache = render_cache[static_cast<size_t>(format)];
+    if (cache.ready) return cache.options[opt_id];
+    return _RenderText(_GetOptionText(opt_id), format);
+  }
 
   size_t GetPoints() const { return _GetConfig(":points", points); }
 
@@ -108,81 +351,121 @@ public:
   void SetFixed() { is_fixed = true; }
   void SetRequired() { is_required = true; }
 
-  void AddText(const emp::String & line) {
+  void AddText(std::string_view line) {
     // Text with a start symbol would have been directed elsewhere.  Regular text is either a
     // question or an extension of the last thing being written.
     switch (last_edit) {
     case Section::NONE:
-      question = line;
-      if (question.size() && question[0] == '+') { is_required = true; question.erase(0,1); }
-      if (question.size() && question[0] == '>') { is_fixed = true;    question.erase(0,1); }
+      if (line.size() && line[0] == '+') { is_required = true; line.remove_prefix(1); }
+      if (line.size() && line[0] == '>') { is_fixed = true;    line.remove_prefix(1); }
+      draft->question.assign(line);
       last_edit = Section::QUESTION;
       break;
     case Section::QUESTION:
-      question.Append('\n', line);
+      draft->question.append(1, '\n').append(line);
       break;
     case Section::ALT_QUESTION:
-      alt_question.Append('\n', line);
+      draft->alt_question.append(1, '\n').append(line);
       break;
     case Section::EXPLANATION:
-      explanation.Append('\n', line);
+      draft->explanation.append(1, '\n').append(line);
       break;
     case Section::OPTIONS:
       AddOption(line);
+      return;
     }
+    _ViewDraft();
   }
 
-  void AddAltQuestion(const emp::String & line) {
-    alt_question = line;
-    last_edit = Section::ALT_QUESTION;    
+  void AddAltQuestion(std::string_view line) {
+    draft->alt_question.assign(line);
+    last_edit = Section::ALT_QUESTION;
+    _ViewDraft();
   }
 
-  void AddExplanation(const emp::String & line) {
-    explanation = line;
+  void AddExplanation(std::string_view line) {
+    draft->explanation.assign(line);
     last_edit = Section::EXPLANATION;
+    _ViewDraft();
   }
 
-  void AddTags(String line) {
-    line.Compress();
-    auto tags = line.Slice(" ");
-    for (auto tag : tags) {      
-      if (tag[0] == '#') base_tags.push_back(tag);
-      else if (tag[0] == '^') exclusive_tags.push_back(tag);
-      else if (tag[0] == ':') {
-        _TestError(!tag.Has('='), "Tag '", tag, "' must have an assignment.");
-        String name = tag.Pop('=');
-        _TestError(tag.size() == 0, "Tag '", tag, "' must have value after '='.");
-        config_tags[name] = tag;
+  void AddTags(std::string_view line) {
+    // Tags are separated by whitespace.
+    size_t pos = 0;
+    while (pos < line.size()) {
+      while (pos < line.size() && std::isspace(static_cast<unsigned char>(line[pos]))) ++pos;
+      if (pos == line.size()) break;
+      const size_t tag_start = pos;
+      while (pos < line.size() && !std::isspace(static_cast<unsigned char>(line[pos]))) ++pos;
+      std::string_view tag = line.substr(tag_start, pos - tag_start);
+
+      if (tag[0] == ':') {
+        const size_t eq_pos = tag.find('=');
+        _TestError(eq_pos == std::string_view::npos, "Tag '", tag, "' must have an assignment.");
+        std::string_view value = tag.substr(std::min(eq_pos + 1, tag.size()));
+        _TestError(value.size() == 0, "Tag '", value, "' must have value after '='.");
       }
-      else {
+      else if (tag[0] != '#' && tag[0] != '^') {
         _Error("Unknown tag type '", tag, "'.");
+        continue;
       }
+      if (draft->tag_text.size()) draft->tag_text += ' ';
+      draft->tag_text.append(tag);
     }
+    tags_indexed = false;
+    _ViewDraft();
   }
 
-  const emp::vector<String> & GetBaseTags() const { return base_tags; }
-  const emp::vector<String> & GetExclusiveTags() const { return exclusive_tags; }
+  std::span<const tag_id_t> GetTagIDs() const { return tag_ids; }
+  std::span<const tag_id_t> GetExclusiveTagIDs() const { return exclusive_ids; }
 
-  bool HasTag(String tag) const {
-    return emp::Has(base_tags, tag) || emp::Has(exclusive_tags, tag) || emp::Has(config_tags, tag);
+  // Convert all tags to IDs from the provided dictionary so that they can be tested quickly,
+  // storing the IDs in arena (ids is working space).  This is done once; the IDs stay valid in
+  // copies of the dictionary (as when a bank reloads).
+  void IndexTags(TagDictionary & dict, TextArena & arena, emp::vector<tag_id_t> & ids) {
+    if (tags_indexed) return;
+    ids.clear();
+    _ForEachTag([&dict, &ids](std::string_view tag){
+      if (tag[0] == '^') ids.push_back(dict.Intern(tag));
+    });
+    exclusive_ids = arena.AddArray(ids);
+    ids.clear();
+    _ForEachTag([&dict, &ids](std::string_view tag){   // Config tags are found by name.
+      ids.push_back(dict.Intern(tag[0] == ':' ? tag.substr(0, tag.find('=')) : tag));
+    });
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    tag_ids = arena.AddArray(ids);
+    tags_indexed = true;
   }
 
-  size_t GetAvoid() const { return avoid; }
-  void IncAvoid() { ++avoid; }
-  void DecayAvoid() { if (avoid) avoid--; }
+  // Does this question have the specified tag (as a base, exclusive, or config tag)?
+  // Questions have only a handful of tags, so this is a search through a few integers.
+  bool HasTag(tag_id_t tag_id) const {
+    return std::binary_search(tag_ids.begin(), tag_ids.end(), tag_id);
+  }
 
   // ----- Virtual Function for Specific Question Types -----
 
-  virtual void AddOption(const emp::String & line) = 0;
-  virtual void AddOption(emp::String tag, const emp::String & option) = 0;
+  virtual void AddOption(std::string_view line) = 0;
+  virtual void AddOption(std::string_view tag, std::string_view option) = 0;
 
-  virtual void Print(std::ostream & os=std::cout) const = 0;
-  virtual void PrintD2L(std::ostream & os=std::cout) const = 0;
-  virtual void PrintGradeScope(std::ostream & os=std::cout, size_t q_num=0, bool compressed=false) const = 0;
-  virtual void PrintHTML(std::ostream & os=std::cout, size_t q_num=0) const = 0;
-  virtual void PrintJS(std::ostream & os=std::cout) const = 0;
-  virtual void PrintLatex(std::ostream & os=std::cout) const = 0;
+  virtual void Print(std::ostream & os, const QuestionLayout & layout) const = 0;
+  virtual void PrintD2L(std::ostream & os, const QuestionLayout & layout) const = 0;
+  virtual void PrintGradeScope(std::ostream & os, const QuestionLayout & layout,
+                               size_t q_num=0, bool compressed=false) const = 0;
+  virtual void PrintHTML(std::ostream & os, const QuestionLayout & layout, size_t q_num=0) const = 0;
+  virtual void PrintJS(std::ostream & os, const QuestionLayout & layout) const = 0;
+  virtual void PrintLatex(std::ostream & os, const QuestionLayout & layout) const = 0;
+
+  virtual void Save(CacheWriter & out) const = 0;
+  virtual void Load(CacheReader & in) = 0;
 
   virtual void Validate() = 0;
-  virtual void Generate(emp::Random & random) = 0;
+
+  // Layout showing the question as written, with all options in their original order.
+  virtual QuestionLayout DefaultLayout() const = 0;
+
+  // Randomly choose a layout for this question on a generated exam.
+  virtual QuestionLayout Generate(emp::Random & random, GenerateCounts & counts) const = 0;
 };
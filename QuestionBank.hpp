@@ -1,5 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
 #include "emp/base/notify.hpp"
 #include "emp/base/Ptr.hpp"
 #include "emp/base/vector.hpp"
@@ -7,66 +17,232 @@
 #include "emp/math/random_utils.hpp"
 #include "emp/tools/String.hpp"
 
+#include "errors.hpp"
+#include "Exam.hpp"
+#include "MappedFile.hpp"
+#include "OutputStream.hpp"
+#include "parallel.hpp"
 #include "Question.hpp"
 #include "Question_MultipleChoice.hpp"
 #include "Question_ShortAnswer.hpp"
+#include "TextArena.hpp"
+#include "TypedPool.hpp"
 
 using emp::String;
 
 class QuestionBank {
 private:
-  emp::vector<emp::Ptr<Question>> questions;
+  emp::vector<emp::Ptr<Question>> questions;   // All questions, in bank order (owned by pools).
+  TypedPool<Question_MultipleChoice> mc_pool;   // Storage for each kind of question.
+  TypedPool<Question_ShortAnswer> sa_pool;
+  TextArena text_arena;             // Text of all questions.
+  TextArena render_arena;           // Question text converted for output formats.
+  std::mutex render_mutex;          // Guards render_arena while formats convert in parallel.
+  QuestionDraft draft;              // Text of the question being parsed, as it is built.
+  emp::Ptr<Question> drafting = nullptr;  // Question whose text is in the draft (if any).
   emp::vector<String> source_files;
   bool start_new = true;            // Should next text start a new question?
 
   bool randomize = true;            // Should we randomize the answer options?
 
-  enum class QType {
-    UNKNOWN = 0,
-    MULTIPLE_CHOICE,
-    SHORT_ANSWER
-  };
   QType question_type = QType::MULTIPLE_CHOICE;
   String default_tags = "";
+  size_t first_id = 1;              // ID for the first question (later when loading a shard).
+  bool hold_output = false;         // Should /print output be held until shards are merged?
+  std::string held_output;          // Output from /print held back during parallel loading.
+  size_t lines_parsed = 0;          // Number of (non-blank) lines parsed into this bank.
+
+  // Where the questions from a source file begin, and the control state at that point, so
+  // that the file can later be parsed again on its own.
+  struct FileStart {
+    size_t q_pos = 0;               // Position of the file's first question in the bank.
+    QType type = QType::MULTIPLE_CHOICE;
+    String tags;
+  };
+  emp::vector<FileStart> file_starts;  // One entry for each of source_files.
+
+  // Information about a question file collected by a quick scan, so that files can be parsed
+  // in parallel while still starting from the same control state as a sequential load.
+  struct FileSummary {
+    size_t q_count = 0;             // Number of questions the file will create.
+    bool sets_type = false;         // Does the file change the question type?
+    QType end_type = QType::UNKNOWN;
+    bool sets_tags = false;         // Does the file change the default tags?
+    String end_tags;
+    bool needs_serial = false;      // Does the file require the full bank state while loading?
+  };
 
   enum class QStatus {
     UNKNOWN = 0,
     EXCLUDED,
     INCLUDED
   };
-  emp::vector<QStatus> q_status;
-  size_t include_count=0;           // Number of questions selected for inclusion.
-  size_t exclude_count=0;           // Number of questions excluded.
+
+  // Working state while choosing the questions for a single exam; the bank itself is untouched.
+  struct GenState {
+    emp::vector<QStatus> q_status;  // Decision so far for each question.
+    emp::vector<bool> group_used;   // For each exclusive tag ID, is a member already included?
+    emp::vector<size_t> avoid;      // How many more times should each question be passed over?
+    size_t include_count=0;         // Number of questions selected for inclusion.
+    size_t exclude_count=0;         // Number of questions excluded.
+    GenerateCounts counts;          // Extra work done along the way.
+  };
 
   using tag_set_t = emp::vector<String>;
+  using tag_id_t = TagDictionary::tag_id_t;
+  TagDictionary tag_dict;           // All tags used in this bank, each with a unique ID.
+  emp::vector<emp::vector<size_t>> tag_postings; // For each tag ID, positions of questions with it.
+  emp::vector<size_t> required_qs;  // Positions of all questions marked as required.
+  emp::vector<size_t> id_positions; // For each question ID, its position in the bank.
+
+  static constexpr size_t NO_POS = static_cast<size_t>(-1);
+
+  // Build the tag -> question index (and list of required questions) for the current order.
+  void _BuildTagIndex() {
+    // Size each list first, so that none of them has to grow as it is filled.
+    emp::vector<size_t> tag_counts(tag_dict.size(), 0);
+    for (auto q : questions) {
+      for (tag_id_t tag : q->GetTagIDs()) ++tag_counts[tag];
+    }
+    tag_postings.assign(tag_dict.size(), {});
+    for (size_t tag = 0; tag < tag_counts.size(); ++tag) tag_postings[tag].reserve(tag_counts[tag]);
+    required_qs.clear();
+    for (size_t pos = 0; pos < questions.size(); ++pos) {
+      for (tag_id_t tag : questions[pos]->GetTagIDs()) tag_postings[tag].push_back(pos);
+      if (questions[pos]->IsRequired()) required_qs.push_back(pos);
+    }
+  }
+
+  void _BuildIDIndex() {
+    id_positions.clear();
+    for (size_t pos = 0; pos < questions.size(); ++pos) {
+      const size_t id = questions[pos]->GetID();
+      if (id >= id_positions.size()) id_positions.resize(id+1, NO_POS);
+      id_positions[id] = pos;
+    }
+  }
+
+  // Positions of all questions with a given tag (empty for unknown tags).
+  const emp::vector<size_t> & _GetPostings(tag_id_t tag) const {
+    static const emp::vector<size_t> empty;
+    return (tag < tag_postings.size()) ? tag_postings[tag] : empty;
+  }
+
+  static constexpr size_t MIN_CHUNK_BYTES = 1 << 20;  // Don't split files into smaller chunks.
+  static constexpr size_t MIN_PRINT_CHUNK = 16;       // Fewest questions rendered in one piece.
+
+  // Call print_entry(os, id) for each entry of an exam.  With multiple threads, contiguous
+  // ranges of entries are rendered concurrently into their own buffers, which are then written
+  // to os in order; every question prints independently, so the output is unchanged.
+  template <typename FUN_T>
+  void _PrintEntries(const Exam & exam, std::ostream & os, size_t num_threads,
+                     FUN_T && print_entry) const {
+    const size_t num_chunks = std::min(num_threads * 4, exam.size() / MIN_PRINT_CHUNK);
+    if (num_threads <= 1 || num_chunks <= 1) {
+      for (size_t id = 0; id < exam.size(); ++id) print_entry(os, id);
+      return;
+    }
+
+    emp::vector<std::string> chunk_text(num_chunks);
+    ParallelFor(num_chunks, num_threads, [&](size_t chunk){
+      OutputStream chunk_os(chunk_text[chunk]);
+      const size_t end = (chunk + 1) * exam.size() / num_chunks;
+      for (size_t id = chunk * exam.size() / num_chunks; id < end; ++id) print_entry(chunk_os, id);
+    });
+    for (const std::string & text : chunk_text) os.write(text.data(), text.size());
+  }
+
+
+  emp::Ptr<Question> _NewQuestion(QType type, size_t id) {
+    switch (type) {
+    case QType::MULTIPLE_CHOICE: return mc_pool.New(id);
+    case QType::SHORT_ANSWER:    return sa_pool.New(id);
+    default:
+      emp::notify::Error("Unknown Question Type ", GetQuestionType());
+    }
+    return nullptr;
+  }
 
+  // Call fun with a question cast to its concrete type.  The question classes are final, so
+  // calls made through the typed reference are direct rather than virtual, letting each
+  // loop over questions be compiled separately for every type.
+  template <typename Q_T, typename FUN_T>
+  static decltype(auto) _Visit(Q_T & q, FUN_T && fun) {
+    constexpr bool is_const = std::is_const_v<Q_T>;
+    using mc_t =
+      std::conditional_t<is_const, const Question_MultipleChoice, Question_MultipleChoice>;
+    using sa_t = std::conditional_t<is_const, const Question_ShortAnswer, Question_ShortAnswer>;
+    if (q.GetType() == QType::MULTIPLE_CHOICE) return fun(static_cast<mc_t &>(q));
+    emp_assert(q.GetType() == QType::SHORT_ANSWER, static_cast<int>(q.GetType()));
+    return fun(static_cast<sa_t &>(q));
+  }
+
+  // Copy a question (from any bank) into this bank's storage, along with its text; text
+  // converted for output formats is not copied, since the other bank may still be converting it.
+  emp::Ptr<Question> _CopyQuestion(const Question & q) {
+    emp::Ptr<Question> new_q = nullptr;
+    switch (q.GetType()) {
+    case QType::MULTIPLE_CHOICE:
+      new_q = mc_pool.New(static_cast<const Question_MultipleChoice &>(q));
+      break;
+    case QType::SHORT_ANSWER:
+      new_q = sa_pool.New(static_cast<const Question_ShortAnswer &>(q));
+      break;
+    default:
+      emp::notify::Error("Unknown Question Type for question ", q.GetID());
+      return nullptr;
+    }
+    new_q->CopyTextTo(text_arena);
+    return new_q;
+  }
+
+  // Move the text of the question being parsed (if any) into the bank's arena.
+  void _FinishDraft() {
+    if (!drafting) return;
+    drafting->FinishDraft(text_arena);
+    drafting = nullptr;
+  }
 
   Question & CurQ() {
     if (start_new) {
-      size_t next_id = questions.size() + 1;
-      emp::Ptr<Question> new_q = nullptr;
-      switch (question_type) {
-      case QType::MULTIPLE_CHOICE:
-        new_q = emp::NewPtr<Question_MultipleChoice>(next_id);
-        break;
-      case QType::SHORT_ANSWER:
-        new_q = emp::NewPtr<Question_ShortAnswer>(next_id);
-        break;
-      default:
-        emp::notify::Error("Unknown Question Type ", GetQuestionType());
-      }
+      _FinishDraft();
+      size_t next_id = first_id + questions.size();
+      emp::Ptr<Question> new_q = _NewQuestion(question_type, next_id);
       questions.push_back(new_q);
-      if (default_tags.size()) new_q->AddTags(default_tags);
+      new_q->StartDraft(draft);
+      drafting = new_q;
+      if (default_tags.size()) new_q->AddTags(default_tags.View());
       start_new = false;
     }
+    else if (drafting != questions.back()) {   // Continuing a question that was finished.
+      _FinishDraft();
+      questions.back()->StartDraft(draft);
+      drafting = questions.back();
+    }
 
     return *questions.back();
   }
+
+  // Convert question text in parallel chunks, calling render(i, arena, scratch) for each i
+  // below count.  Each chunk converts into its own arena with its own scratch space (so nothing
+  // is allocated per question), and the bank then takes over the chunk's arena.
+  template <typename FUN_T>
+  void _RenderChunks(size_t count, size_t num_threads, FUN_T && render) {
+    const size_t num_chunks =
+      std::max<size_t>(1, std::min(num_threads * 4, count / MIN_PRINT_CHUNK));
+    ParallelFor(num_chunks, num_threads, [this, count, num_chunks, &render](size_t chunk){
+      TextArena arena;
+      MarkupScratch scratch;
+      const size_t end = (chunk + 1) * count / num_chunks;
+      for (size_t i = chunk * count / num_chunks; i < end; ++i) render(i, arena, scratch);
+      std::lock_guard<std::mutex> lock(render_mutex);
+      render_arena.Absorb(std::move(arena));
+    });
+  }
 public:
   QuestionBank() { }
-  ~QuestionBank() {
-    for (auto ptr : questions) ptr.Delete();
-  }
+  QuestionBank(const QuestionBank &) = delete;
+  QuestionBank & operator=(const QuestionBank &) = delete;
 
   String GetQuestionType() const {
     switch (question_type) {
@@ -78,15 +254,41 @@ public:
     return "Invalid";
   }
 
+  size_t GetNumQuestions() const { return questions.size(); }
+  size_t GetNumTags() const { return tag_dict.size(); }
+  size_t GetLinesParsed() const { return lines_parsed; }
+
+  size_t CountQuestions(QType type) const {
+    return std::count_if(questions.begin(), questions.end(),
+                         [type](emp::Ptr<Question> q){ return q->GetType() == type; });
+  }
+
   void NewEntry() { start_new = true; }
 
-  void NewFile(String filename) { source_files.push_back(filename), start_new = true; }
+  void NewFile(String filename) {
+    source_files.push_back(filename);
+    file_starts.push_back(FileStart{questions.size(), question_type, default_tags});
+    start_new = true;
+  }
+
+  // Remove the first whitespace-delimited word from a line (and the whitespace after it).
+  static std::string_view _PopWord(std::string_view & line) {
+    auto is_space = [](char c){ return std::isspace(static_cast<unsigned char>(c)); };
+    size_t start = 0;
+    while (start < line.size() && is_space(line[start])) ++start;
+    size_t end = start;
+    while (end < line.size() && !is_space(line[end])) ++end;
+    std::string_view word = line.substr(start, end - start);
+    while (end < line.size() && is_space(line[end])) ++end;
+    line.remove_prefix(end);
+    return word;
+  }
 
   /// Process the provided line to change behavior of QBL.
-  void ProcessControl(String line) {
-    String command = line.PopWord();
+  void ProcessControl(std::string_view line) {
+    std::string_view command = _PopWord(line);
     if (command == "/use_tags") {              // Add provided tags to all subsequent questions
-      default_tags = line;
+      default_tags = String(line);
     }
     else if (command == "/multiple_choice") {  // Change question type to multiple choice
       question_type = QType::MULTIPLE_CHOICE;
@@ -95,7 +297,8 @@ public:
       question_type = QType::SHORT_ANSWER;
     }
     else if (command == "/print") {            // Print provided info to standard output.
-      std::cout << line << std::endl;
+      if (hold_output) held_output.append(line).append("\n");
+      else std::cout << line << std::endl;
     }
     else if (command == "/print_status") {     // Print the current status to standard output.
       // If there is anything else on this line, print it as a header.
@@ -107,8 +310,250 @@ public:
     }
   }
 
-  void AddLine(String line) {
-    emp::String tag;
+  // Quickly scan a question file to find how many questions it creates and how it changes
+  // the control state, without building any questions.
+  static FileSummary _SummarizeFile(std::string_view text) {
+    FileSummary summary;
+    bool at_new = true;
+    ScanQBLLines(text,
+      [&summary, &at_new](std::string_view line) {
+        if (line[0] != '/') {
+          if (at_new) { ++summary.q_count; at_new = false; }
+          return;
+        }
+        std::string_view command = _PopWord(line);
+        if (command == "/use_tags") {
+          summary.sets_tags = true;
+          summary.end_tags = String(line);
+        }
+        else if (command == "/multiple_choice") {
+          summary.sets_type = true;
+          summary.end_type = QType::MULTIPLE_CHOICE;
+        }
+        else if (command == "/short_answer") {
+          summary.sets_type = true;
+          summary.end_type = QType::SHORT_ANSWER;
+        }
+        else if (command == "/print_status") summary.needs_serial = true;
+      },
+      [&at_new](){ at_new = true; });
+    return summary;
+  }
+
+  // Move all of the questions (and output) from a separately loaded shard into this bank.
+  void _MergeShard(QuestionBank & shard) {
+    for (FileStart & start : shard.file_starts) start.q_pos += questions.size();
+    emp::Append(questions, shard.questions);
+    shard.questions.clear();
+    mc_pool.Absorb(std::move(shard.mc_pool));
+    sa_pool.Absorb(std::move(shard.sa_pool));
+    text_arena.Absorb(std::move(shard.text_arena));
+    emp::Append(source_files, shard.source_files);
+    emp::Append(file_starts, shard.file_starts);
+    lines_parsed += shard.lines_parsed;
+    if (shard.held_output.size()) std::cout << shard.held_output << std::flush;
+  }
+
+  // Load a single question file into this bank.  Files are normally memory-mapped; with
+  // copy_file they are read into memory instead, which is safe even if the file is being
+  // rewritten at the same time.
+  void LoadFile(const String & filename, bool copy_file=false) {
+    NewFile(filename);   // Let the question bank know we are loading from a new file.
+    if (copy_file) {
+      std::string text;
+      if (!ReadFileText(filename, text)) {
+        ReportError("Unable to open question file '", filename, "'.");
+        return;
+      }
+      LoadText(text);
+      return;
+    }
+    MappedFile file(filename);
+    if (!file) {
+      ReportError("Unable to open question file '", filename, "'.");
+      return;
+    }
+    LoadText(file.View());
+  }
+
+  void LoadText(std::string_view text) {
+    ScanQBLLines(text,
+                 [this](std::string_view line){ AddLine(line); },
+                 [this](){ NewEntry(); });
+    _FinishDraft();
+  }
+
+  // Load a set of question files, parsing them in parallel when multiple threads are available.
+  // Large files are split into chunks at blank lines (which always end a question) so that
+  // they can be parsed in parallel too.  Results (question IDs, source files, and control
+  // state) match loading the files in order, one line at a time.
+  void LoadFiles(const emp::vector<String> & filenames, size_t num_threads=1) {
+    if (num_threads <= 1) {
+      for (const String & filename : filenames) LoadFile(filename);
+      return;
+    }
+
+    // Map all of the files and divide them into chunks.
+    emp::vector<MappedFile> files;
+    size_t total_bytes = 0;
+    for (const String & filename : filenames) {
+      files.emplace_back(filename);
+      TestReportError(!files.back(), "Unable to open question file '", filename, "'.");
+      total_bytes += files.back().View().size();
+    }
+
+    struct Chunk {
+      size_t file_id;               // Which file is this chunk from?
+      std::string_view text;        // Text of this chunk.
+      bool file_start;              // Is this the first chunk in its file?
+    };
+    emp::vector<Chunk> chunks;
+    const size_t chunk_target = std::max(MIN_CHUNK_BYTES, total_bytes / (num_threads * 4));
+    for (size_t file_id = 0; file_id < files.size(); ++file_id) {
+      std::string_view text = files[file_id].View();
+      size_t start = 0;
+      do {
+        size_t end = (text.size() - start > chunk_target) ?
+          FindBlankLineBreak(text, start + chunk_target) : text.size();
+        chunks.push_back(Chunk{file_id, text.substr(start, end - start), start == 0});
+        start = end;
+      } while (start < text.size());
+    }
+
+    if (chunks.size() <= 1) {
+      for (const String & filename : filenames) LoadFile(filename);
+      return;
+    }
+
+    // Scan each chunk to determine the state it should start in.
+    emp::vector<FileSummary> summaries(chunks.size());
+    ParallelFor(chunks.size(), num_threads,
+                [&](size_t i){ summaries[i] = _SummarizeFile(chunks[i].text); });
+
+    // Some control commands (such as /print_status) need the whole bank; load those in order.
+    for (const auto & summary : summaries) {
+      if (summary.needs_serial) {
+        for (const String & filename : filenames) LoadFile(filename);
+        return;
+      }
+    }
+
+    // Give each chunk its own shard, set up as it would be at that point in a sequential load.
+    emp::vector<QuestionBank> shards(chunks.size());
+    size_t next_id = first_id + questions.size();
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      QuestionBank & shard = shards[i];
+      shard.question_type = question_type;
+      shard.default_tags = default_tags;
+      shard.first_id = next_id;
+      shard.hold_output = true;
+      if (chunks[i].file_start) shard.NewFile(filenames[chunks[i].file_id]);
+
+      next_id += summaries[i].q_count;
+      if (summaries[i].sets_type) question_type = summaries[i].end_type;
+      if (summaries[i].sets_tags) default_tags = summaries[i].end_tags;
+    }
+
+    ParallelFor(chunks.size(), num_threads, [&](size_t i){ shards[i].LoadText(chunks[i].text); });
+
+    for (auto & shard : shards) _MergeShard(shard);
+    start_new = true;
+  }
+
+  // Give the questions parsed again from one file (positions new_start onward) IDs, reusing
+  // those of the old questions they replace (old positions [old_start, old_end)).  Questions
+  // whose wording is unchanged keep their IDs.  Each other question takes the ID of the next
+  // unmatched old question in the same stretch between unchanged ones (so an edited question
+  // keeps its ID); any left over get new IDs.
+  void _ReuseIDs(const QuestionBank & old, size_t old_start, size_t old_end, size_t new_start,
+                 size_t & next_id) {
+    const size_t new_count = questions.size() - new_start;
+    std::unordered_map<std::string_view, emp::vector<size_t>> old_by_text;
+    for (size_t pos = old_end; pos > old_start; --pos) {   // Reversed, so pop_back is in order.
+      old_by_text[old.questions[pos-1]->GetQuestion()].push_back(pos-1);
+    }
+    emp::vector<size_t> match(new_count, NO_POS);           // Old position for each new question.
+    emp::vector<bool> old_used(old_end - old_start, false);
+    for (size_t i = 0; i < new_count; ++i) {
+      auto it = old_by_text.find(questions[new_start + i]->GetQuestion());
+      if (it == old_by_text.end() || it->second.empty()) continue;
+      match[i] = it->second.back();
+      it->second.pop_back();
+      old_used[match[i] - old_start] = true;
+    }
+
+    // For each new question, the old position of the next matched question after it.
+    emp::vector<size_t> next_match(new_count, old_end);
+    for (size_t i = new_count; i > 1; --i) {
+      next_match[i-2] = (match[i-1] != NO_POS) ? match[i-1] : next_match[i-1];
+    }
+
+    size_t old_pos = old_start;
+    for (size_t i = 0; i < new_count; ++i) {
+      Question & q = *questions[new_start + i];
+      if (match[i] != NO_POS) {
+        q.SetID(old.questions[match[i]]->GetID());
+        old_pos = std::max(old_pos, match[i] + 1);
+        continue;
+      }
+      const size_t limit = (next_match[i] >= old_pos) ? next_match[i] : old_end;
+      while (old_pos < limit && old_used[old_pos - old_start]) ++old_pos;
+      if (old_pos < limit) {
+        old_used[old_pos - old_start] = true;
+        q.SetID(old.questions[old_pos++]->GetID());
+      }
+      else q.SetID(next_id++);
+    }
+  }
+
+  // Fill this (empty) bank from an existing one, parsing the listed source files (by position
+  // in source_files) again and copying the questions from all others.  A file is also parsed
+  // again if the control state it starts in has changed.  Unchanged questions keep their IDs,
+  // and the old bank is untouched, so it can keep serving while this one is built.
+  void ReloadFrom(const QuestionBank & old, const emp::vector<size_t> & changed_files) {
+    emp::vector<bool> reparse(old.source_files.size(), false);
+    for (size_t file_id : changed_files) reparse[file_id] = true;
+
+    randomize = old.randomize;
+    first_id = old.first_id;
+    tag_dict = old.tag_dict;
+    size_t next_id = first_id;
+    for (auto q : old.questions) next_id = std::max(next_id, q->GetID() + 1);
+
+    for (size_t file_id = 0; file_id < old.source_files.size(); ++file_id) {
+      const FileStart & old_start = old.file_starts[file_id];
+      const bool is_last = (file_id + 1 == old.source_files.size());
+      const size_t old_end = is_last ? old.questions.size() : old.file_starts[file_id+1].q_pos;
+      if (file_id == 0) {
+        question_type = old_start.type;
+        default_tags = old_start.tags;
+      }
+
+      if (reparse[file_id] || question_type != old_start.type || default_tags != old_start.tags) {
+        const size_t new_start = questions.size();
+        LoadFile(old.source_files[file_id], true);   // The file may still be being saved.
+        start_new = true;
+        _ReuseIDs(old, old_start.q_pos, old_end, new_start, next_id);
+        for (size_t pos = new_start; pos < questions.size(); ++pos) {
+          _Visit(*questions[pos], [](auto & q){ q.Validate(); });
+        }
+        continue;
+      }
+
+      NewFile(old.source_files[file_id]);
+      for (size_t pos = old_start.q_pos; pos < old_end; ++pos) {
+        questions.push_back(_CopyQuestion(*old.questions[pos]));
+      }
+      question_type = is_last ? old.question_type : old.file_starts[file_id+1].type;
+      default_tags = is_last ? old.default_tags : old.file_starts[file_id+1].tags;
+    }
+
+    IndexTags();
+  }
+
+  void AddLine(std::string_view line) {
+    std::string_view tag;
+    ++lines_parsed;
 
     // The first character on a line determines what that line is.
     switch (line[0]) {
@@ -119,7 +564,7 @@ public:
     case '[':                         // Question option (correct)
     case '+':                         // Question option (mandatory)
     case '>':                         // Question option (locked position or short-answer response)
-      tag = line.PopWord();
+      tag = _PopWord(line);
       CurQ().AddOption(tag, line);
       break;
     case '#':                         // Regular question tag
@@ -131,7 +576,7 @@ public:
       CurQ().AddAltQuestion(line);
       break;
     case '-':                         // Override other start characters and add the rest.
-      line.erase(line.begin());
+      line.remove_prefix(1);
       CurQ().AddText(line);
       break;
     default:                          // Otherwise it must be part of the question itself.
@@ -139,125 +584,247 @@ public:
     }
   }
 
-  void Randomize(emp::Random & random) {
+  // Save all loaded questions to a compiled cache file, keyed to the provided sources (which
+  // should be hashed before the files are parsed).  Tags must already be indexed.
+  bool SaveCache(const String & filename, const emp::vector<CacheSource> & sources) const {
+    CacheWriter out(tag_dict);
+    out.Write(static_cast<uint8_t>(question_type));
+    out.Write(default_tags);
+    out.Write<uint64_t>(file_starts.size());
+    for (const FileStart & start : file_starts) {
+      out.Write<uint64_t>(start.q_pos);
+      out.Write(static_cast<uint8_t>(start.type));
+      out.Write(start.tags);
+    }
+    out.Write<uint64_t>(questions.size());
+    for (auto q : questions) {
+      out.Write(static_cast<uint8_t>(q->GetType()));
+      q->Save(out);
+    }
+    return out.Save(filename, sources);
+  }
+
+  // Load questions into this (empty) bank from a compiled cache file, with their tags already
+  // indexed.  Returns false (leaving the bank unchanged) if the cache is missing, corrupt, or
+  // was built from different sources; any sources hashed while checking keep their hashes.
+  bool LoadCache(const String & filename, emp::vector<CacheSource> & sources) {
+    if (questions.size() || tag_dict.size()) return false;
+    TextArena cached_text;
+    CacheReader in(cached_text);
+    if (!in.Open(filename, sources)) return false;
+
+    const QType cached_type = static_cast<QType>(in.Read<uint8_t>());
+    String cached_tags = in.ReadString();
+    if (in.Read<uint64_t>() != sources.size()) return false;
+    emp::vector<FileStart> cached_starts(sources.size());
+    for (FileStart & start : cached_starts) {
+      start.q_pos = in.Read<uint64_t>();
+      start.type = static_cast<QType>(in.Read<uint8_t>());
+      start.tags = in.ReadString();
+    }
+    const size_t mc_start = mc_pool.size();
+    const size_t sa_start = sa_pool.size();
+    emp::vector<emp::Ptr<Question>> cached_qs;
+    const uint64_t q_count = in.Read<uint64_t>();
+    for (uint64_t i = 0; i < q_count && in.IsOK(); ++i) {
+      const QType type = static_cast<QType>(in.Read<uint8_t>());
+      if (type != QType::MULTIPLE_CHOICE && type != QType::SHORT_ANSWER) break;
+      emp::Ptr<Question> new_q = _NewQuestion(type, 0);
+      new_q->Load(in);
+      cached_qs.push_back(new_q);
+    }
+
+    TagDictionary cached_dict;
+    for (const auto & tag : in.GetTags()) cached_dict.Intern(tag.View());
+
+    if (!in.IsOK() || cached_qs.size() != q_count || !in.AtEnd() ||
+        cached_dict.size() != in.GetTags().size()) {
+      mc_pool.ShrinkTo(mc_start);
+      sa_pool.ShrinkTo(sa_start);
+      return false;
+    }
+
+    emp::Append(questions, cached_qs);
+    text_arena.Absorb(std::move(cached_text));
+    tag_dict = std::move(cached_dict);
+    for (const auto & source : sources) source_files.push_back(source.filename);
+    file_starts = cached_starts;
+    question_type = cached_type;
+    default_tags = cached_tags;
+    start_new = true;
+    return true;
+  }
+
+  // Build an exam with every question in the bank, in bank order, with default layouts.
+  Exam MakeExam() const {
+    Exam exam;
+    exam.entries.resize(questions.size());
+    for (size_t pos = 0; pos < questions.size(); ++pos) {
+      exam.entries[pos].bank_pos = pos;
+      exam.entries[pos].layout =
+        _Visit(*questions[pos], [](const auto & q){ return q.DefaultLayout(); });
+    }
+    return exam;
+  }
+
+  void Randomize(Exam & exam, emp::Random & random) const {
     // Randomize the order of the questions.
     /// @todo take into account fixed positions.
-    emp::Shuffle(random, questions);
+    emp::Shuffle(random, exam.entries);
   }
 
-  void SortID() {
-    std::sort(questions.begin(), questions.end(),
-              [](emp::Ptr<Question> a, emp::Ptr<Question> b){
-                return a->GetID() < b->GetID();
+  void SortID(Exam & exam) const {
+    std::sort(exam.entries.begin(), exam.entries.end(),
+              [this](const ExamEntry & a, const ExamEntry & b){
+                return questions[a.bank_pos]->GetID() < questions[b.bank_pos]->GetID();
               });
   }
 
-  void SortAlpha() {
-    std::sort(questions.begin(), questions.end(),
-              [](emp::Ptr<Question> a, emp::Ptr<Question> b){
-                return a->GetQuestion() < b->GetQuestion();
+  void SortAlpha(Exam & exam) const {
+    std::sort(exam.entries.begin(), exam.entries.end(),
+              [this](const ExamEntry & a, const ExamEntry & b){
+                return questions[a.bank_pos]->GetQuestion(a.layout) <
+                       questions[b.bank_pos]->GetQuestion(b.layout);
               });
   }
 
+  // Once all questions are loaded, give every tag an ID and index each question's tags.
+  void IndexTags() {
+    emp::vector<tag_id_t> ids;
+    for (auto q : questions) q->IndexTags(tag_dict, text_arena, ids);
+    _BuildTagIndex();
+    _BuildIDIndex();
+  }
+
   void Validate() {
-    for (auto & q : questions) q->Validate();
+    for (auto q : questions) _Visit(*q, [](auto & typed_q){ typed_q.Validate(); });
   }
 
   // Exclude the specified question.  Report any problems.
-  void Generate_ExcludeQuestion(size_t id, String reason) {
-    emp::notify::TestError(q_status[id] == QStatus::INCLUDED,
+  void Generate_ExcludeQuestion(GenState & state, size_t id, String reason) const {
+    TestReportError(state.q_status[id] == QStatus::INCLUDED,
       "Question ", id, " being excluded (", reason, "), but already included.");
-    if (q_status[id] == QStatus::UNKNOWN) {
-      q_status[id] = QStatus::EXCLUDED;
-      exclude_count++;
+    if (state.q_status[id] == QStatus::UNKNOWN) {
+      state.q_status[id] = QStatus::EXCLUDED;
+      state.exclude_count++;
     }
   }
 
   // Include the specified question.  Report any problems.
-  void Generate_IncludeQuestion(size_t id, String reason) {
+  void Generate_IncludeQuestion(GenState & state, size_t id, String reason) const {
     // If a question should be avoided, reduce the avoid count and defer selecting it for now.
-    if (questions[id]->GetAvoid()) {
-      questions[id]->DecayAvoid();
+    if (state.avoid[id]) {
+      state.avoid[id]--;
       return;
     }
 
-    emp::notify::TestError(q_status[id] == QStatus::EXCLUDED,
+    TestReportError(state.q_status[id] == QStatus::EXCLUDED,
       "Question ", id, " being included (", reason, "), but already excluded.");
-    if (q_status[id] == QStatus::INCLUDED) return; // Already included.
-
-    // If there are any exclusive tags, honor them.
-    const auto & exclude_tags = questions[id]->GetExclusiveTags();
-    for (const auto & tag : exclude_tags) {
-      for (size_t i = 0; i < questions.size(); ++i) {
+    if (state.q_status[id] == QStatus::INCLUDED) return; // Already included.
+
+    // If there are any exclusive tags, honor them.  The first question included from a group
+    // excludes all other members; after that they are already excluded and can be skipped.
+    const auto & exclude_tags = questions[id]->GetExclusiveTagIDs();
+    for (tag_id_t tag : exclude_tags) {
+      if (state.group_used[tag]) continue;
+      state.group_used[tag] = true;
+      for (size_t i : _GetPostings(tag)) {
         if (i == id) continue;
-        if (questions[i]->HasTag(tag)) {
-          Generate_ExcludeQuestion(i, MakeString("Conflict with tag '", tag, "'"));
-        }
+        state.counts.group_conflicts += (state.q_status[i] == QStatus::UNKNOWN);
+        Generate_ExcludeQuestion(state, i,
+          emp::MakeString("Conflict with tag '", tag_dict.GetName(tag), "'"));
       }
     }
 
-    q_status[id] = QStatus::INCLUDED;
-    include_count++;
+    state.q_status[id] = QStatus::INCLUDED;
+    state.include_count++;
   }
 
-  void Generate_SetupAvoids(const emp::vector<String> & avoid_files) {
+  void Generate_SetupAvoids(GenState & state, const emp::vector<String> & avoid_files) const {
     for (const String & filename : avoid_files) {
       std::ifstream file(filename);
-      emp::notify::TestError(!file, "Unable to open avoid file '", filename, "'. Skipping.");
+      TestReportError(!file, "Unable to open avoid file '", filename, "'. Skipping.");
       size_t id;
       while (file >> id) {
-        size_t index = id-1;  // Question IDs start at 1; indices start at zero.
-        if (index >= questions.size()) {
-          emp::notify::Warning("Cannot avoid Question '", id, "' only ",
-                               questions.size(), " questions available.");
+        const size_t index = (id < id_positions.size()) ? id_positions[id] : NO_POS;
+        if (index == NO_POS) {
+          emp::notify::Warning("Cannot avoid Question '", id, "'; no question has that ID.");
           continue;
         }
-        emp::notify::TestError(id != questions[index]->GetID(), "mismatched ID; ", id, " != ", questions[index]->GetID());
-        questions[index]->IncAvoid();
+        state.avoid[index]++;
       }
     }
   }
 
-  // Scan through all of the questions and remove those that either have an excluded tag or don't have a required tag.
-  void Generate_DoExcludes(const tag_set_t & exclude_tags, const tag_set_t & require_tags) {
-    for (size_t i = 0; i < questions.size(); ++i) {
-      for (const auto & tag : exclude_tags) {
-        if (questions[i]->HasTag(tag)) Generate_ExcludeQuestion(i, "has exclude tag");
+  // Exclude all questions that either have an excluded tag or don't have every required tag.
+  void Generate_DoExcludes(GenState & state, const tag_set_t & exclude_tags,
+                           const tag_set_t & require_tags) const {
+    // With required tags, only questions in the shortest posting list are candidates to keep.
+    if (require_tags.size()) {
+      auto require_ids = tag_dict.GetIDs(require_tags);
+      std::sort(require_ids.begin(), require_ids.end());
+      require_ids.erase(std::unique(require_ids.begin(), require_ids.end()), require_ids.end());
+      tag_id_t rarest = require_ids[0];
+      for (tag_id_t tag : require_ids) {
+        if (_GetPostings(tag).size() < _GetPostings(rarest).size()) rarest = tag;
       }
-      for (const auto & tag : require_tags) {
-        if (!questions[i]->HasTag(tag)) Generate_ExcludeQuestion(i, "doesn't have required tag");
+
+      std::fill(state.q_status.begin(), state.q_status.end(), QStatus::EXCLUDED);
+      state.exclude_count = questions.size();
+      for (size_t pos : _GetPostings(rarest)) {
+        const bool has_all = std::all_of(require_ids.begin(), require_ids.end(),
+          [this, pos](tag_id_t tag){ return questions[pos]->HasTag(tag); });
+        if (has_all) { state.q_status[pos] = QStatus::UNKNOWN; state.exclude_count--; }
       }
     }
+
+    for (tag_id_t tag : tag_dict.GetIDs(exclude_tags)) {
+      for (size_t pos : _GetPostings(tag)) Generate_ExcludeQuestion(state, pos, "has exclude tag");
+    }
   }
 
-  // Scan through all of the questions and included the ones we are required to.
-  void Generate_DoIncludes(const tag_set_t & include_tags) {
-    // Handle include tags.
-    for (size_t i = 0; i < questions.size(); ++i) {
-      if (questions[i]->IsRequired()) Generate_IncludeQuestion(i, "marked required");
-      for (const auto & tag : include_tags) {
-        if (questions[i]->HasTag(tag)) Generate_IncludeQuestion(i, "has include tag");
-      }
+  // Include all required questions and all those with an include tag.
+  void Generate_DoIncludes(GenState & state, const tag_set_t & include_tags) const {
+    // Collect every (question, reason) pair, then process them in question order; a question
+    // is offered once per reason so that avoid counts decay exactly as with a full scan.
+    enum Reason { REQUIRED = 0, INCLUDE_TAG };
+    emp::vector<std::pair<size_t, Reason>> picks;
+    for (size_t pos : required_qs) picks.emplace_back(pos, REQUIRED);
+    for (tag_id_t tag : tag_dict.GetIDs(include_tags)) {
+      for (size_t pos : _GetPostings(tag)) picks.emplace_back(pos, INCLUDE_TAG);
+    }
+    std::stable_sort(picks.begin(), picks.end(),
+                     [](const auto & a, const auto & b){ return a.first < b.first; });
+
+    for (auto [pos, reason] : picks) {
+      Generate_IncludeQuestion(state, pos, reason == REQUIRED ? "marked required" : "has include tag");
     }
   }
 
-  void Generate_DoSamples(emp::Random & random, const tag_set_t & sample_tags) {
-    for (const String & tag : sample_tags) {
+  void Generate_DoSamples(GenState & state, emp::Random & random,
+                          const tag_set_t & sample_tags) const {
+    const auto sample_ids = tag_dict.GetIDs(sample_tags);
+    std::unordered_map<tag_id_t, int> sample_targets;   // How many times is each tag sampled?
+    for (tag_id_t tag_id : sample_ids) sample_targets[tag_id]++;
+
+    for (size_t tag_pos = 0; tag_pos < sample_tags.size(); ++tag_pos) {
+      const String & tag = sample_tags[tag_pos];
+      const tag_id_t tag_id = sample_ids[tag_pos];
       emp::vector<size_t> tag_ids; // Question IDs to choose from with this tag.
       int sample_count = 0;
-      for (size_t id=0; id < questions.size(); ++id) {
-        // Skip questions that don't have the tag or are already excluded.
-        if (!questions[id]->HasTag(tag) || q_status[id] == QStatus::EXCLUDED) continue;
+      for (size_t id : _GetPostings(tag_id)) {
+        // Skip questions that are already excluded.
+        if (state.q_status[id] == QStatus::EXCLUDED) continue;
 
         // If a question with the tag is already included, we are done!
-        if (q_status[id] == QStatus::INCLUDED) {
+        if (state.q_status[id] == QStatus::INCLUDED) {
           sample_count += 1;
           continue;
         }
 
         tag_ids.push_back(id); // Track this question as one to possibly add.
       }
-      if (sample_count == std::count(sample_tags.begin(), sample_tags.end(), tag)) continue;
+      if (sample_count == sample_targets[tag_id]) continue;
 
       if (tag_ids.size() == 0) {
         emp::notify::Warning("Unable to find sample for tag '", tag, "'.");
@@ -265,112 +832,180 @@ public:
       }
 
       size_t sample_id = emp::SelectRandom(random, tag_ids);
-      Generate_IncludeQuestion(sample_id, "sampled for tag");
+      Generate_IncludeQuestion(state, sample_id, "sampled for tag");
     }
   }
 
-  // Remove all of the questions that we are not going to use.
-  void Generate_PurgeUnused() {
-    for (size_t i = questions.size()-1; i < questions.size(); --i) {
-      if (q_status[i] != QStatus::INCLUDED) {
-        questions[i].Delete();
-        questions.erase(questions.begin() + i);
-      }
-    }
-  }
-
-  void Generate(size_t count, emp::Random & random, const tag_set_t & include_tags,
+  // Choose questions for a new exam and lay each of them out.  The bank is left unchanged, so
+  // it can be used to generate any number of exams.
+  Exam Generate(size_t count, emp::Random & random, const tag_set_t & include_tags,
                 const tag_set_t & exclude_tags, const tag_set_t & require_tags,
-                const tag_set_t & sample_tags, const emp::vector<String> & avoid_files) {
+                const tag_set_t & sample_tags, const emp::vector<String> & avoid_files) const {
     emp::notify::TestWarning(count > questions.size(), "Requesting more questions (", count,
       ") than available in Question Bank (", questions.size(), ")");
 
     // Setup analysis for picking questions.
-    q_status.resize(questions.size(), QStatus::UNKNOWN);
-    include_count = 0;
-    exclude_count = 0;
-
-    Generate_SetupAvoids(avoid_files);
-    Generate_DoExcludes(exclude_tags, require_tags);
-    Generate_DoIncludes(include_tags);
-    Generate_DoSamples(random, sample_tags);
-
-    // Pick them randomly from here to fill in the rest;
-    // loop as long as we need questions and there are some left.
-    while (include_count < count && include_count + exclude_count < questions.size()) {
-      size_t pick = random.GetUInt(questions.size());
-      if (q_status[pick] != QStatus::UNKNOWN) continue;
-      Generate_IncludeQuestion(pick, "random pick");
+    GenState state;
+    state.q_status.resize(questions.size(), QStatus::UNKNOWN);
+    state.group_used.resize(tag_dict.size(), false);
+    state.avoid.resize(questions.size(), 0);
+
+    Generate_SetupAvoids(state, avoid_files);
+    Generate_DoExcludes(state, exclude_tags, require_tags);
+    Generate_DoIncludes(state, include_tags);
+    Generate_DoSamples(state, random, sample_tags);
+
+    // Fill in the rest with random picks from the undecided questions, using a partial
+    // Fisher-Yates shuffle: the first pool_size entries of the pool are still available.
+    // Questions excluded along the way are dropped when drawn; avoided ones stay in the pool
+    // until their avoid count runs out.  Every draw therefore makes progress.
+    emp::vector<size_t> pool;
+    for (size_t pos = 0; pos < questions.size(); ++pos) {
+      if (state.q_status[pos] == QStatus::UNKNOWN) pool.push_back(pos);
+    }
+    size_t pool_size = pool.size();
+    while (state.include_count < count && pool_size) {
+      const size_t pool_pos = random.GetUInt(pool_size);
+      const size_t pick = pool[pool_pos];
+      if (state.q_status[pick] == QStatus::UNKNOWN) {
+        Generate_IncludeQuestion(state, pick, "random pick");
+        if (state.q_status[pick] == QStatus::UNKNOWN) {   // Avoided for now.
+          state.counts.rejected_draws++;
+          continue;
+        }
+      }
+      else state.counts.rejected_draws++;                 // Excluded since the pool was made.
+      std::swap(pool[pool_pos], pool[--pool_size]);
     }
 
-    emp::notify::TestWarning(include_count < count,
-      "Unable to select ", count, " questions given exclusions; only ", include_count, " used.");
+    emp::notify::TestWarning(state.include_count < count,
+      "Unable to select ", count, " questions given exclusions; only ",
+      state.include_count, " used.");
+
+    // Keep the picked questions (in bank order) and decide how each one is presented.
+    Exam exam;
+    exam.include_count = state.include_count;
+    exam.exclude_count = state.exclude_count;
+    exam.entries.reserve(state.include_count);
+    for (size_t pos = 0; pos < questions.size(); ++pos) {
+      if (state.q_status[pos] != QStatus::INCLUDED) continue;
+      auto generate = [&](const auto & q){ return q.Generate(random, state.counts); };
+      exam.entries.push_back(ExamEntry{pos, _Visit(*questions[pos], generate)});
+    }
+    exam.counts = state.counts;
+    return exam;
+  }
 
-    // Remove any questions that were not picked during generation
-    Generate_PurgeUnused();
+  // Convert the text of every question used on these exams to the given formats ahead of
+  // time, so that each is converted only once however many exams it appears on.
+  void PrepareRender(const emp::vector<Exam> & exams, const emp::vector<TextFormat> & formats,
+                     size_t num_threads=1) {
+    if (formats.empty()) return;
+    emp::vector<bool> is_used(questions.size(), false);
+    emp::vector<size_t> used_qs;
+    for (const Exam & exam : exams) {
+      for (const auto & entry : exam.entries) {
+        if (is_used[entry.bank_pos]) continue;
+        is_used[entry.bank_pos] = true;
+        used_qs.push_back(entry.bank_pos);
+      }
+    }
+    _RenderChunks(used_qs.size(), num_threads,
+      [this, &used_qs, &formats](size_t i, TextArena & arena, MarkupScratch & scratch){
+        for (TextFormat format : formats) {
+          questions[used_qs[i]]->PrepareRender(format, arena, scratch);
+        }
+      });
+  }
 
-    // Go through each of the kept questions an limit the choices.
-    for (auto q : questions) q->Generate(random);
+  // Convert the text of every question to a format, carrying on past any question that cannot
+  // be converted.  Returns an error message for each bank position (empty if it converted).
+  emp::vector<String> TryPrepareRender(TextFormat format, size_t num_threads=1) {
+    emp::vector<String> errors(questions.size());
+    _RenderChunks(questions.size(), num_threads,
+      [this, &errors, format](size_t pos, TextArena & arena, MarkupScratch & scratch){
+        ErrorTrap trap;
+        questions[pos]->PrepareRender(format, arena, scratch);
+        if (trap.HasError()) {
+          errors[pos] = emp::MakeString("Question ", questions[pos]->GetID(),
+                                        " cannot be converted: ", trap.GetError());
+        }
+      });
+    return errors;
   }
 
-  void Print(std::ostream & os=std::cout) const {
-    for (size_t id = 0; id < questions.size(); ++id) {
-      questions[id]->Print(os);
-    }
+  void Print(const Exam & exam, std::ostream & os=std::cout, size_t num_threads=1) const {
+    _PrintEntries(exam, os, num_threads, [this, &exam](std::ostream & out, size_t id){
+      const ExamEntry & entry = exam[id];
+      _Visit(*questions[entry.bank_pos], [&](const auto & q){ q.Print(out, entry.layout); });
+    });
   }
 
-  void PrintD2L(std::ostream & os=std::cout) const {
-    for (size_t id = 0; id < questions.size(); ++id) {
-      questions[id]->PrintD2L(os);
-    }
+  void PrintD2L(const Exam & exam, std::ostream & os=std::cout, size_t num_threads=1) const {
+    _PrintEntries(exam, os, num_threads, [this, &exam](std::ostream & out, size_t id){
+      const ExamEntry & entry = exam[id];
+      _Visit(*questions[entry.bank_pos], [&](const auto & q){ q.PrintD2L(out, entry.layout); });
+    });
   }
 
-  void PrintGradeScope(std::ostream & os=std::cout, bool compressed = false) const {
-    for (size_t id = 0; id < questions.size(); ++id) {
-      questions[id]->PrintGradeScope(os, id+1, compressed);
-    }
+  void PrintGradeScope(const Exam & exam, std::ostream & os=std::cout, bool compressed = false,
+                       size_t num_threads=1) const {
+    _PrintEntries(exam, os, num_threads, [this, &exam, compressed](std::ostream & out, size_t id){
+      const ExamEntry & entry = exam[id];
+      _Visit(*questions[entry.bank_pos], [&](const auto & q){
+        q.PrintGradeScope(out, entry.layout, id+1, compressed);
+      });
+    });
   }
 
-  void PrintHTML(std::ostream & os=std::cout) const {
-    for (size_t id = 0; id < questions.size(); ++id) {
-      questions[id]->PrintHTML(os, id+1);
-    }
+  void PrintHTML(const Exam & exam, std::ostream & os=std::cout, size_t num_threads=1) const {
+    _PrintEntries(exam, os, num_threads, [this, &exam](std::ostream & out, size_t id){
+      const ExamEntry & entry = exam[id];
+      _Visit(*questions[entry.bank_pos], [&](const auto & q){
+        q.PrintHTML(out, entry.layout, id+1);
+      });
+    });
   }
 
-  void PrintJS(std::ostream & os=std::cout) const {
-    for (size_t id = 0; id < questions.size(); ++id) {
-      questions[id]->PrintJS(os);
+  // JS output stays serial so that any warnings are reported in question order.
+  void PrintJS(const Exam & exam, std::ostream & os=std::cout) const {
+    for (const auto & entry : exam.entries) {
+      _Visit(*questions[entry.bank_pos], [&](const auto & q){ q.PrintJS(os, entry.layout); });
     }
   }
 
-  void PrintLatex(std::ostream & os=std::cout) const {
-    for (size_t id = 0; id < questions.size(); ++id) {
-      questions[id]->PrintLatex(os);
-    }
+  void PrintLatex(const Exam & exam, std::ostream & os=std::cout, size_t num_threads=1) const {
+    _PrintEntries(exam, os, num_threads, [this, &exam](std::ostream & out, size_t id){
+      const ExamEntry & entry = exam[id];
+      _Visit(*questions[entry.bank_pos], [&](const auto & q){ q.PrintLatex(out, entry.layout); });
+    });
   }
 
-  void PrintDebug(std::ostream & os=std::cout) const {
+  void PrintDebug(const Exam & exam, std::ostream & os=std::cout) const {
     os << "Question Bank\n"
        << "  source files:  " << MakeLiteral(source_files) << '\n'
        << "  num questions: " << questions.size() << '\n'
-       << "    ...included:  " << include_count << '\n'
-       << "    ...excluded:  " << exclude_count << '\n'
-       << "    ...undecided: " << (questions.size() - include_count - exclude_count) << '\n'
+       << "    ...included:  " << exam.include_count << '\n'
+       << "    ...excluded:  " << exam.exclude_count << '\n'
+       << "    ...undecided: " << (questions.size() - exam.include_count - exam.exclude_count) << '\n'
        << "  randomize answers?: " << randomize << '\n'
-       << "  default question type: " << GetQuestionType()
-       << std::endl;
+       << "  default question type: " << GetQuestionType() << '\n';
   }
 
-  void LogQuestions(std::ostream & os) const {
-    for (auto q_ptr : questions) {
-      os << q_ptr->GetID() << '\n';
+  // Status of the bank alone, before any exam is generated.
+  void PrintDebug(std::ostream & os=std::cout) const { PrintDebug(Exam{}, os); }
+
+  void LogQuestions(const Exam & exam, std::ostream & os) const {
+    for (const auto & entry : exam.entries) {
+      os << questions[entry.bank_pos]->GetID() << '\n';
     }
   }
 
-  void LogQuestions(String filename) const {
+  // Returns the number of bytes written to the log file.
+  size_t LogQuestions(const Exam & exam, String filename) const {
     emp::notify::Message("Printing log file of question IDs '", filename, "'.");
-    std::ofstream out_file(filename);
-    LogQuestions(out_file);
-    out_file.close();
+    OutputStream out_file(filename);
+    LogQuestions(exam, out_file);
+    return out_file.GetBytesWritten();
   }
 };
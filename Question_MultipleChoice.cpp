@@ -5,26 +5,28 @@
 
 using emp::MakeCount;
 
-void Question_MultipleChoice::Print(std::ostream& os) const {
-  os << "%- QUESTION " << id << "\n" << question << "\n";
-  for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
-    os << options[opt_id].GetQBLBullet() << " " << options[opt_id].text << '\n';
+void Question_MultipleChoice::Print(std::ostream& os, const QuestionLayout & layout) const {
+  os << "%- QUESTION " << id << "\n" << GetQuestion(layout) << "\n";
+  for (size_t pos = 0; pos < layout.option_order.size(); ++pos) {
+    const size_t opt_id = layout.option_order[pos];
+    os << _GetQBLBullet(opt_id, _IsCorrect(layout, pos)) << " " << _GetOptionText(opt_id) << '\n';
   }
-  os << std::endl;
+  os << '\n';
 }
 
-void Question_MultipleChoice::PrintD2L(std::ostream& os) const {
+void Question_MultipleChoice::PrintD2L(std::ostream& os, const QuestionLayout & layout) const {
   os << "NewQuestion,MC,,,\n"
     << "ID,QBL-" << id << ",,,\n"
     << "Title,,,,\n"
-    << "QuestionText," << TextToD2L(question) << ",HTML,,\n"
+    << "QuestionText," << RenderQuestion(layout, TextFormat::D2L) << ",HTML,,\n"
     << "Points," << GetPoints() << ",,,\n"
     << "Difficulty,1,,,\n"
     << "Image,,,,\n";
-  for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
-    os << "Option," << (options[opt_id].is_correct ? 100 : 0) << ","
-       << TextToD2L(options[opt_id].text) << ",HTML,"
-       << options[opt_id].feedback << "\n";
+  for (size_t pos = 0; pos < layout.option_order.size(); ++pos) {
+    const size_t opt_id = layout.option_order[pos];
+    os << "Option," << (_IsCorrect(layout, pos) ? 100 : 0) << ","
+       << RenderOption(opt_id, TextFormat::D2L) << ",HTML,"
+       << _GetFeedback(opt_id) << "\n";
   }
   os << "Hint," << hint << ",,,\n"
      << "Feedback," << explanation << ",HTML,,\n"
@@ -32,7 +34,9 @@ void Question_MultipleChoice::PrintD2L(std::ostream& os) const {
      << ",,,,\n";
 }
 
-void Question_MultipleChoice::PrintGradeScope(std::ostream& os, size_t q_num, bool compressed) const {
+void Question_MultipleChoice::PrintGradeScope(std::ostream& os, const QuestionLayout & layout,
+                                              size_t q_num, bool compressed) const {
+  const size_t num_options = layout.option_order.size();
   size_t opt_width = 0;
   size_t num_correct = correct_range.GetSize();
   std::string bubble_type = "\\chooseone ";
@@ -40,107 +44,177 @@ void Question_MultipleChoice::PrintGradeScope(std::ostream& os, size_t q_num, bo
     bubble_type = "\\choosemany ";
   }
   
-  for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
+  for (size_t pos = 0; pos < num_options; ++pos) {
     opt_width += 10; // Fixed amount per option.
-    opt_width += LineToRawText(options[opt_id].text).size();
+    opt_width += RenderOption(layout.option_order[pos], TextFormat::RAW).size();
   }
 
   os << "% QUESTION ID " << id << "\n"
      << "\\noindent\\begin{minipage}{\\linewidth}\n"
      << "\\vspace{20pt}\\hangpara{1.8em}{1}\n"
-     << q_num << ". " << TextToLatex(question);
+     << q_num << ". " << RenderQuestion(layout, TextFormat::LATEX);
 
   if (opt_width < 100) {  // All on one line.
     os << "\\\\\n"
        << "\\vspace{1pt}\\\\\n";
-    for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
+    for (size_t pos = 0; pos < num_options; ++pos) {
       os << bubble_type;
-      if (options[opt_id].is_correct) os << "\\showcorrect ";
-      os << TextToLatex(options[opt_id].text) << " \\hspace*{3em}\n";
+      if (_IsCorrect(layout, pos)) os << "\\showcorrect ";
+      os << RenderOption(layout.option_order[pos], TextFormat::LATEX) << " \\hspace*{3em}\n";
     }
   } else if (compressed) {
     os << "\\\\\n";
     int curr_width = 0;
-    for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
-      curr_width += 10 + LineToRawText(options[opt_id].text).size();
+    for (size_t pos = 0; pos < num_options; ++pos) {
+      const size_t opt_id = layout.option_order[pos];
+      const size_t raw_width = RenderOption(opt_id, TextFormat::RAW).size();
+      curr_width += 10 + raw_width;
       if (curr_width > 100) {
         os << "\\\\\n";
-        curr_width = 10 + LineToRawText(options[opt_id].text).size();
+        curr_width = 10 + raw_width;
       }
       os << bubble_type;
-      if (options[opt_id].is_correct) os << "\\showcorrect ";
-      os << TextToLatex(options[opt_id].text) << " \\hspace*{.5em}\n";
+      if (_IsCorrect(layout, pos)) os << "\\showcorrect ";
+      os << RenderOption(opt_id, TextFormat::LATEX) << " \\hspace*{.5em}\n";
     }
   } else {
     os << "\n"
       << "\\begin{itemize}[label={}]\n";
-    for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
+    for (size_t pos = 0; pos < num_options; ++pos) {
       os << "\\item " << bubble_type;
-      if (options[opt_id].is_correct) os << "\\showcorrect ";
-      os << TextToLatex(options[opt_id].text) << '\n';
+      if (_IsCorrect(layout, pos)) os << "\\showcorrect ";
+      os << RenderOption(layout.option_order[pos], TextFormat::LATEX) << '\n';
     }
     os << "\\end{itemize}\n";
   }
 
   os << "\\end{minipage}\n"
-     << std::endl;
+     << '\n';
 }
 
-void Question_MultipleChoice::PrintHTML(std::ostream & os, size_t q_num) const {
+void Question_MultipleChoice::PrintHTML(std::ostream & os, const QuestionLayout & layout,
+                                        size_t q_num) const {
   os << "  <!-- Question " << id << " -->\n"
      << "  <div class=\"question\">\n"
      << "    <p><b>";
   if (q_num) os << q_num << ".</b> ";  // If we were given a number > 0, print it.
-  os << TextToHTML(question) <<  "</p>\n";
+  os << RenderQuestion(layout, TextFormat::HTML) <<  "</p>\n";
 
   // Print options.
-  for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
+  for (size_t pos = 0; pos < layout.option_order.size(); ++pos) {
     os << "    <div class=\"options\"><label><input type=\"radio\" name=\"q" << id
-       << "\" value=\"" << _OptionLabel(opt_id) << "\">"
-       << _OptionLabel(opt_id) << " "
-       << TextToHTML(options[opt_id].text) << "</label></div>\n";
+       << "\" value=\"" << _OptionLabel(pos) << "\">"
+       << _OptionLabel(pos) << " "
+       << RenderOption(layout.option_order[pos], TextFormat::HTML) << "</label></div>\n";
   }
   
   // Leave a div to place the answer.
   os << "  <div class=\"answer\" data-question=\"q" << id << "\"></div> <!-- Placeholder for answer -->"
      << "</div>\n"
-     << std::endl; // Skip a line.
+     << '\n'; // Skip a line.
 }
 
-void Question_MultipleChoice::PrintJS(std::ostream & os) const {
-  _TestWarning(CountCorrect() != 1,
-    "Web mode expects exactly one correct answer per question; ", CountCorrect(), " found.");
-  os << "    q" << id << ": \"" << _OptionLabel(FindCorrectID()) << "\",\n";
+void Question_MultipleChoice::PrintJS(std::ostream & os, const QuestionLayout & layout) const {
+  const size_t correct_count = _CountShownCorrect(layout);
+  _TestWarning(correct_count != 1,
+    "Web mode expects exactly one correct answer per question; ", correct_count, " found.");
+  os << "    q" << id << ": \"" << _OptionLabel(FindCorrectID(layout)) << "\",\n";
 }
 
-void Question_MultipleChoice::PrintLatex(std::ostream& os) const {
+void Question_MultipleChoice::PrintLatex(std::ostream& os, const QuestionLayout & layout) const {
   os << "% QUESTION " << id << "\n"
-     << "\\question " << TextToLatex(question) << "\n"
-     << std::endl
+     << "\\question " << RenderQuestion(layout, TextFormat::LATEX) << "\n"
+     << '\n'
      << "\\begin{mcanswerslist}";
-  size_t fixed_count = CountFixed();
+  size_t fixed_count = _CountShownFixed(layout);
   if (fixed_count) {
-    if (fixed_count == 1 && HasFixedLast()) {
+    if (fixed_count == 1 && HasFixedLast(layout)) {
       os << "[fixlast]";
     } else {
       os << "[permutenone]";
     }
   }
-  os << std::endl;
+  os << '\n';
 
-  for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
+  for (size_t pos = 0; pos < layout.option_order.size(); ++pos) {
     os << "\\answer";
-    if (options[opt_id].is_correct) os << "[correct]";
-    os << " " << TextToLatex(options[opt_id].text) << '\n';
+    if (_IsCorrect(layout, pos)) os << "[correct]";
+    os << " " << RenderOption(layout.option_order[pos], TextFormat::LATEX) << '\n';
   }
 
-  os << "\\end{mcanswerslist}\n" << std::endl;
+  os << "\\end{mcanswerslist}\n" << '\n';
+}
+
+void Question_MultipleChoice::_GroupOptions(TextArena & arena) {
+  std::span<uint32_t> groups = arena.NewArray<uint32_t>(CountOptions());
+  size_t pos = 0;
+  for (uint32_t i = 0; i < CountOptions(); ++i) if (_IsRequiredID(i)) groups[pos++] = i;
+  num_required_ids = static_cast<uint32_t>(pos);
+  for (uint32_t i = 0; i < CountOptions(); ++i) {
+    if (!_IsRequiredID(i) && _IsCorrectID(i)) groups[pos++] = i;
+  }
+  num_correct_ids = static_cast<uint32_t>(pos) - num_required_ids;
+  for (uint32_t i = 0; i < CountOptions(); ++i) {
+    if (!_IsRequiredID(i) && !_IsCorrectID(i)) groups[pos++] = i;
+  }
+  option_groups = groups;
+}
+
+void Question_MultipleChoice::StartDraft(QuestionDraft & in_draft) {
+  if (draft == &in_draft) return;
+  Question::StartDraft(in_draft);
+  draft->option_feedback = option_feedback;
+  draft->feedback_ends.assign(feedback_ends.begin(), feedback_ends.end());
+  option_feedback = draft->option_feedback;
+  feedback_ends = draft->feedback_ends;
+}
+
+void Question_MultipleChoice::FinishDraft(TextArena & arena) {
+  option_feedback = arena.AddText(draft->option_feedback);
+  feedback_ends = arena.AddArray(draft->feedback_ends);
+  Question::FinishDraft(arena);
+  _GroupOptions(arena);
+}
+
+void Question_MultipleChoice::CopyTextTo(TextArena & arena) {
+  Question::CopyTextTo(arena);
+  option_feedback = arena.AddText(option_feedback);
+  feedback_ends = arena.AddArray(feedback_ends.data(), feedback_ends.size());
+  option_groups = arena.AddArray(option_groups.data(), option_groups.size());
+}
+
+// Options are saved as the blobs they are stored in, so loading them is a few bulk copies.
+void Question_MultipleChoice::Save(CacheWriter & out) const {
+  _SaveBase(out);
+  out.Write(option_feedback);
+  out.WriteArray(feedback_ends);
+  correct_mask.Save(out);
+  fixed_mask.Save(out);
+  required_mask.Save(out);
+}
+
+void Question_MultipleChoice::Load(CacheReader & in) {
+  _LoadBase(in);
+  option_feedback = in.ReadText();
+  feedback_ends = in.ReadArray<uint32_t>();
+  correct_mask.Load(in);
+  fixed_mask.Load(in);
+  required_mask.Load(in);
+
+  // Make sure the option offsets are usable before anything slices with them.
+  if (text_ends.size() != feedback_ends.size() ||
+      !_EndsFit(feedback_ends, option_feedback.size())) {
+    in.SetError();
+  }
+  if (!in.IsOK()) return;
+  _GroupOptions(in.GetArena());
+  if (CountOptions()) last_edit = Section::OPTIONS;
 }
 
 void Question_MultipleChoice::Validate() {
   // Collect config info for this question.
   correct_range = _GetConfig(":correct", emp::Range<size_t>(1,1));
-  option_range = _GetConfig(":options", emp::Range<size_t>(options.size(),options.size()));
+  option_range = _GetConfig(":options", emp::Range<size_t>(CountOptions(),CountOptions()));
 
   // Are there enough correct answers?
   const size_t correct_count = CountCorrect();
@@ -164,7 +238,7 @@ void Question_MultipleChoice::Validate() {
   option_range.LimitLower(required_count);     // Must at least select required options.
 
   // Are there enough available options?
-  const size_t incorrect_count = options.size() - correct_count;
+  const size_t incorrect_count = CountOptions() - correct_count;
   const size_t max_options = incorrect_count + correct_range.Upper();
   _TestError(max_options < option_range.Lower(),
     " Max of ", MakeCount(correct_range.Upper(), "correct answer"), " and ",
@@ -172,83 +246,109 @@ void Question_MultipleChoice::Validate() {
     " options.");
   option_range.LimitUpper(max_options);     // Must at least select required options.
 
-  // Make sure that all fixed-order options are at the beginning or end.
-  size_t test_pos = 0;
-  while (test_pos < options.size() && options[test_pos].is_fixed) test_pos++;  // Front fixed.
-  while (test_pos < options.size() && !options[test_pos].is_fixed) test_pos++; // Middle NOT fixed.
-  while (test_pos < options.size() && options[test_pos].is_fixed) test_pos++;  // Back fixed.
-  _TestError(test_pos < options.size(),
+  // Make sure that all fixed-order options are at the beginning or end; that is, the options
+  // that are NOT fixed form a single run.
+  size_t free_start = 0;
+  while (free_start < CountOptions() && _IsFixedID(free_start)) free_start++;
+  size_t free_end = free_start;
+  while (free_end < CountOptions() && !_IsFixedID(free_end)) free_end++;
+  size_t fixed_after = free_end;
+  while (fixed_after < CountOptions() && _IsFixedID(fixed_after)) fixed_after++;
+  _TestError(fixed_after < CountOptions(),
     "Has fixed-position options in middle; fixed positions must be at start and end.");
+
 }
 
-void Question_MultipleChoice::ReduceOptions(emp::Random& random, size_t correct_target,
-                             size_t incorrect_target) {
-  emp_assert(correct_target <= CountCorrect());
-  emp_assert(incorrect_target <= CountIncorrect());
+// Append k distinct entries of ids, chosen uniformly at random, to out.  Uses Floyd's
+// algorithm: exactly k random draws and no rejections, however long ids is; a draw that
+// repeats an earlier pick takes the newest candidate instead.  Returns how often that happened.
+static size_t SampleIDs(emp::Random & random, std::span<const uint32_t> ids, size_t k,
+                        emp::vector<uint32_t> & out) {
+  emp_assert(k <= ids.size());
+  const auto start = out.size();
+  size_t collisions = 0;
+  for (size_t j = ids.size() - k; j < ids.size(); ++j) {
+    const uint32_t pick = ids[random.GetUInt64(j+1)];
+    const bool taken = std::find(out.begin() + start, out.end(), pick) != out.end();
+    out.push_back(taken ? ids[j] : pick);
+    collisions += taken;
+  }
+  return collisions;
+}
 
-  // Pick the set of options to use.
-  emp::BitVector used(options.size());
-  size_t correct_picks = 0, incorrect_picks = 0;
+void Question_MultipleChoice::ReduceOptions(emp::Random& random, size_t correct_target,
+                             size_t incorrect_target, QuestionLayout & layout,
+                             GenerateCounts & counts) const {
+  // Option correctness as presented (negated when using the alternate wording).
+  auto is_correct = [this, &layout](size_t i){ return _IsCorrectID(i) != layout.use_alt; };
+  emp_assert(correct_target <= (layout.use_alt ? CountIncorrect() : CountCorrect()));
+  emp_assert(incorrect_target <= (layout.use_alt ? CountCorrect() : CountIncorrect()));
 
   // Start with required options.
-  for (size_t i = 0; i < options.size(); ++i) {
-    if (options[i].is_required) {
-      used[i].Set();
-      (options[i].is_correct ? correct_picks : incorrect_picks)++;
-    }
+  auto & order = layout.option_order;
+  const auto required_ids = _RequiredIDs();
+  order.assign(required_ids.begin(), required_ids.end());
+  size_t correct_picks = 0;
+  for (uint32_t i : required_ids) correct_picks += is_correct(i);
+  const size_t incorrect_picks = required_ids.size() - correct_picks;
+
+  // Sample the rest directly from the remaining options of each kind.
+  const auto shown_correct = layout.use_alt ? _IncorrectIDs() : _CorrectIDs();
+  const auto shown_incorrect = layout.use_alt ? _CorrectIDs() : _IncorrectIDs();
+  if (correct_picks < correct_target) {
+    counts.option_collisions +=
+      SampleIDs(random, shown_correct, correct_target - correct_picks, order);
   }
-
-  // Randomly choose remaining options.
-  while (correct_picks < correct_target || incorrect_picks < incorrect_target) {
-    size_t pick = random.GetUInt64(options.size());
-    if (used[pick]) continue;
-
-    if ((options[pick].is_correct && (correct_picks == correct_target)) ||
-        (!options[pick].is_correct && (incorrect_picks == incorrect_target)))
-      continue;
-
-    used.Set(pick);
-    (options[pick].is_correct ? correct_picks : incorrect_picks)++;
+  if (incorrect_picks < incorrect_target) {
+    counts.option_collisions +=
+      SampleIDs(random, shown_incorrect, incorrect_target - incorrect_picks, order);
   }
 
-  // Limit to just the answer options that we're using.
-  for (size_t i = used.size() - 1; i < used.size(); --i) {
-    if (!used[i]) options.erase(options.begin() + i);
-  }
+  // Keep the chosen options in their original order.
+  std::sort(order.begin(), order.end());
 }
 
-void Question_MultipleChoice::ShuffleOptions(emp::Random& random) {
+void Question_MultipleChoice::ShuffleOptions(emp::Random& random, QuestionLayout & layout) const {
   // Find the option range to shuffle.
+  auto & order = layout.option_order;
   size_t first_id = 0;
-  while (first_id < options.size() && options[first_id].is_fixed) first_id++;
+  while (first_id < order.size() && _IsFixedID(order[first_id])) first_id++;
   size_t last_id = first_id;
-  while (last_id < options.size() && !options[last_id].is_fixed) last_id++;
+  while (last_id < order.size() && !_IsFixedID(order[last_id])) last_id++;
+
+  emp::ShuffleRange(random, order, first_id, last_id);
+}
 
-  emp::ShuffleRange(random, options, first_id, last_id);
+QuestionLayout Question_MultipleChoice::DefaultLayout() const {
+  QuestionLayout layout;
+  layout.option_order.resize(CountOptions());
+  for (size_t i = 0; i < CountOptions(); ++i) layout.option_order[i] = static_cast<uint32_t>(i);
+  return layout;
 }
 
-void Question_MultipleChoice::Generate(emp::Random & random) {
+QuestionLayout Question_MultipleChoice::Generate(emp::Random & random,
+                                                GenerateCounts & counts) const {
+  QuestionLayout layout = DefaultLayout();
+
   // Determine if we are going to toggle this question to its alternate form.
   double alt_p = _GetConfig(":alt_prob", 0.5);
-  if (alt_question.size() && random.P(alt_p)) {
-    std::swap(question, alt_question);
-    for (auto & opt : options) {
-      opt.is_correct = !opt.is_correct;
-    }
-  }
+  if (alt_question.size() && random.P(alt_p)) layout.use_alt = true;
 
   size_t correct_target =
       random.GetUInt(correct_range.GetLower(), correct_range.GetUpper() + 1);
-  option_range.LimitLower(correct_target);
+  emp::Range<size_t> target_range = option_range;
+  target_range.LimitLower(correct_target);
   size_t option_target =
-      random.GetUInt(option_range.GetLower(), option_range.GetUpper() + 1);
+      random.GetUInt(target_range.GetLower(), target_range.GetUpper() + 1);
   size_t incorrect_target = option_target - correct_target;
 
   // Trim down the set of options if we need to.
-  if (option_target != options.size()) {
-    ReduceOptions(random, correct_target, incorrect_target);
+  if (option_target != CountOptions()) {
+    ReduceOptions(random, correct_target, incorrect_target, layout, counts);
   }
 
   // Reorder the possible answers
-  ShuffleOptions(random);
+  ShuffleOptions(random, layout);
+
+  return layout;
 }
@@ -1,34 +1,142 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
 #include "Question.hpp"
 
 // A class to define multiple-choice style questions.
-class Question_MultipleChoice : public Question {
+class Question_MultipleChoice final : public Question {
 private:
-  struct Option {
-    String text;       ///< Wording for this option.
-    bool is_correct;   ///< Is this option marked as a correct answer?
-    bool is_fixed;     ///< Is this option in a fixed position?
-    bool is_required;  ///< Does this option have to be included?
-    String feedback;   ///< Feedback for a student picking this option.
-
-    String GetQBLBullet() const {
-      String out("*");
-      if (is_required) out += '+';
-      if (is_fixed) out += '>';
-      if (is_correct) out.Set('[', out, ']');
-      return out;
+  // One bit per option, by position, in as many 64-bit words as the options need.  Most
+  // questions have few options, so the first word is kept inline and only longer questions
+  // (such as large banks of distractors) use the overflow words.
+  class OptionMask {
+  private:
+    using word_t = uint64_t;
+    static constexpr size_t WORD_BITS = 64;
+
+    word_t first = 0;                  ///< Options 0 through 63.
+    emp::vector<word_t> rest;          ///< Options 64 and up, if there are any.
+
+  public:
+    bool Has(size_t opt_id) const {
+      if (opt_id < WORD_BITS) return (first >> opt_id) & 1;
+      const size_t word_id = opt_id / WORD_BITS - 1;
+      return word_id < rest.size() && ((rest[word_id] >> (opt_id % WORD_BITS)) & 1);
+    }
+
+    void Set(size_t opt_id) {
+      if (opt_id < WORD_BITS) { first |= word_t{1} << opt_id; return; }
+      const size_t word_id = opt_id / WORD_BITS - 1;
+      if (word_id >= rest.size()) rest.resize(word_id + 1, 0);
+      rest[word_id] |= word_t{1} << (opt_id % WORD_BITS);
+    }
+
+    size_t Count() const {
+      size_t count = static_cast<size_t>(std::popcount(first));
+      for (word_t word : rest) count += static_cast<size_t>(std::popcount(word));
+      return count;
+    }
+
+    // Count the options set in both this mask and another.
+    size_t CountBoth(const OptionMask & other) const {
+      size_t count = static_cast<size_t>(std::popcount(first & other.first));
+      const size_t shared = std::min(rest.size(), other.rest.size());
+      for (size_t i = 0; i < shared; ++i) {
+        count += static_cast<size_t>(std::popcount(rest[i] & other.rest[i]));
+      }
+      return count;
+    }
+
+    void Save(CacheWriter & out) const {
+      out.Write(first);
+      out.WriteArray(rest);
+    }
+    void Load(CacheReader & in) {
+      first = in.Read<word_t>();
+      const auto words = in.ReadArray<word_t>();
+      rest.assign(words.begin(), words.end());
     }
   };
 
-  emp::vector<Option> options;  ///< Set of all possible options for answers.
+  // Options are stored as parallel arrays rather than one object each: the text of every
+  // option is kept back to back in a single block (option_text, in the base class), and each
+  // flag is a bitmask over options.
+  std::string_view option_feedback;         ///< Feedback for students picking each option.
+  std::span<const uint32_t> feedback_ends;  ///< Position in option_feedback where each ends.
+  OptionMask correct_mask;                  ///< Options marked as a correct answer.
+  OptionMask fixed_mask;                    ///< Options in a fixed position.
+  OptionMask required_mask;                 ///< Options that have to be included.
 
   emp::Range<size_t> correct_range;  ///< How many "correct" answers should there be?
   emp::Range<size_t> option_range;   ///< How many question options to show to students?
 
-  template <typename FUN_T>
-  size_t _Count(FUN_T fun) const {
-    return std::count_if(options.begin(), options.end(), fun);
+  // Option positions grouped for sampling: required options first, then the correct and then
+  // the incorrect options that are not required.
+  std::span<const uint32_t> option_groups;
+  uint32_t num_required_ids = 0;     ///< Size of the required group.
+  uint32_t num_correct_ids = 0;      ///< Size of the (not required) correct group.
+
+  bool _IsCorrectID(size_t opt_id) const { return correct_mask.Has(opt_id); }
+  bool _IsFixedID(size_t opt_id) const { return fixed_mask.Has(opt_id); }
+  bool _IsRequiredID(size_t opt_id) const { return required_mask.Has(opt_id); }
+
+  std::span<const uint32_t> _RequiredIDs() const {
+    return option_groups.first(num_required_ids);
+  }
+  std::span<const uint32_t> _CorrectIDs() const {
+    return option_groups.subspan(num_required_ids, num_correct_ids);
+  }
+  std::span<const uint32_t> _IncorrectIDs() const {
+    return option_groups.subspan(num_required_ids + num_correct_ids);
+  }
+
+  // Fill in option_groups (stored in arena) from the option masks.
+  void _GroupOptions(TextArena & arena);
+
+  std::string_view _GetFeedback(size_t opt_id) const {
+    return _Slice(option_feedback, feedback_ends, opt_id);
+  }
+
+  String _GetQBLBullet(size_t opt_id, bool show_correct) const {
+    String out("*");
+    if (_IsRequiredID(opt_id)) out += '+';
+    if (_IsFixedID(opt_id)) out += '>';
+    if (show_correct) out.Set('[', out, ']');
+    return out;
+  }
+
+  // Access options as they appear in a layout (correctness is negated for alternate wording).
+  bool _IsCorrect(const QuestionLayout & layout, size_t pos) const {
+    return _IsCorrectID(layout.option_order[pos]) != layout.use_alt;
+  }
+  size_t _CountShownCorrect(const QuestionLayout & layout) const {
+    size_t count = 0;
+    for (size_t pos = 0; pos < layout.option_order.size(); ++pos) count += _IsCorrect(layout, pos);
+    return count;
+  }
+  size_t _CountShownFixed(const QuestionLayout & layout) const {
+    size_t count = 0;
+    for (uint32_t opt_id : layout.option_order) count += _IsFixedID(opt_id);
+    return count;
+  }
+
+  // Append a new option with the given flags.
+  void _PushOption(std::string_view text, bool is_correct, bool is_fixed, bool is_required,
+                   std::string_view feedback) {
+    const size_t opt_id = text_ends.size();
+    if (is_correct) correct_mask.Set(opt_id);
+    if (is_fixed) fixed_mask.Set(opt_id);
+    if (is_required) required_mask.Set(opt_id);
+    draft->option_feedback.append(feedback);
+    draft->feedback_ends.push_back(static_cast<uint32_t>(draft->option_feedback.size()));
+    option_feedback = draft->option_feedback;
+    feedback_ends = draft->feedback_ends;
+    _PushOptionText(text);
   }
 
   String _OptionLabel(size_t id) const {
@@ -36,55 +144,71 @@ private:
   }
 
 public:
-  Question_MultipleChoice() { }
-  Question_MultipleChoice(size_t id) : Question(id) { }  ///< Constructor that specified ID.
+  Question_MultipleChoice() : Question(QType::MULTIPLE_CHOICE) { }
+  Question_MultipleChoice(size_t id)   ///< Constructor that specified ID.
+    : Question(QType::MULTIPLE_CHOICE, id) { }
   Question_MultipleChoice(const Question_MultipleChoice &) = default;  ///< Copy Constructor
   Question_MultipleChoice(Question_MultipleChoice &&) = default;       ///< Move Constructor
 
   Question_MultipleChoice & operator=(const Question_MultipleChoice &) = default;
   Question_MultipleChoice & operator=(Question_MultipleChoice &&) = default;
 
-  size_t CountCorrect() const { return _Count([](const Option & o){ return o.is_correct; }); }
-  size_t CountIncorrect() const { return _Count([](const Option & o){ return !o.is_correct; }); }
-  size_t CountRequired() const { return _Count([](const Option & o){ return o.is_required; }); }
-  size_t CountRequiredCorrect() const
-    { return _Count([](const Option & o){ return o.is_correct && o.is_required; }); }
-  size_t CountFixed() const { return _Count([](const Option & o){ return o.is_fixed; }); }
-
-  size_t FindCorrectID(size_t start=0) const {
-    for (size_t i = start; i < options.size(); ++i) {
-      if (options[i].is_correct) return i;
+  size_t CountOptions() const { return text_ends.size(); }
+  size_t CountCorrect() const { return correct_mask.Count(); }
+  size_t CountIncorrect() const { return CountOptions() - CountCorrect(); }
+  size_t CountRequired() const { return required_mask.Count(); }
+  size_t CountRequiredCorrect() const { return required_mask.CountBoth(correct_mask); }
+  size_t CountFixed() const { return fixed_mask.Count(); }
+
+  // Find the position of the first correct option shown in a layout.
+  size_t FindCorrectID(const QuestionLayout & layout, size_t start=0) const {
+    for (size_t i = start; i < layout.option_order.size(); ++i) {
+      if (_IsCorrect(layout, i)) return i;
     }
     return static_cast<size_t>(-1);
   }
 
-  bool HasFixedLast() const { return options.size() && options.back().is_fixed; }
+  bool HasFixedLast(const QuestionLayout & layout) const {
+    return layout.option_order.size() && _IsFixedID(layout.option_order.back());
+  }
 
-  void AddOption(const emp::String & line) override {
-    options.back().text.Append('\n', line);
+  // Continue the last option; its text is at the end of the pool, so it can simply grow.
+  void AddOption(std::string_view line) override {
+    if (text_ends.empty()) return;
+    draft->option_text.append(1, '\n').append(line);
+    draft->text_ends.back() = static_cast<uint32_t>(draft->option_text.size());
+    _ViewDraft();
   }
 
-  void AddOption(emp::String tag, const emp::String & option) override {
-    options.push_back(
-      Option{option,            // Option text.
-            (tag[0] == '['),    // Is it correct?
-            tag.Has('>'),       // Is it in a fixed position?
-            tag.Has('+'),       // Is it required?
-            ""                  // Explanation to student
-            });      
-      last_edit = Section::OPTIONS;
+  void AddOption(std::string_view tag, std::string_view option) override {
+    _PushOption(option,
+                (tag[0] == '['),                          // Is it correct?
+                tag.find('>') != std::string_view::npos,  // Is it in a fixed position?
+                tag.find('+') != std::string_view::npos,  // Is it required?
+                "");                                      // Explanation to student
+    last_edit = Section::OPTIONS;
   }
 
-  void Print(std::ostream & os=std::cout) const override;
-  void PrintD2L(std::ostream & os=std::cout) const override;
-  void PrintGradeScope(std::ostream & os=std::cout, size_t q_num=0, bool compressed = false) const override;
-  void PrintHTML(std::ostream & os=std::cout, size_t q_num=0) const override;
-  void PrintJS(std::ostream & os=std::cout) const override;
-  void PrintLatex(std::ostream & os=std::cout) const override;
+  void Print(std::ostream & os, const QuestionLayout & layout) const override;
+  void PrintD2L(std::ostream & os, const QuestionLayout & layout) const override;
+  void PrintGradeScope(std::ostream & os, const QuestionLayout & layout,
+                       size_t q_num=0, bool compressed = false) const override;
+  void PrintHTML(std::ostream & os, const QuestionLayout & layout, size_t q_num=0) const override;
+  void PrintJS(std::ostream & os, const QuestionLayout & layout) const override;
+  void PrintLatex(std::ostream & os, const QuestionLayout & layout) const override;
+
+  void ReduceOptions(emp::Random & random, size_t correct_target, size_t incorrect_target,
+                     QuestionLayout & layout, GenerateCounts & counts) const;
+  void ShuffleOptions(emp::Random & random, QuestionLayout & layout) const;
+
+  void StartDraft(QuestionDraft & in_draft) override;
+  void FinishDraft(TextArena & arena) override;
+  void CopyTextTo(TextArena & arena) override;
 
-  void ReduceOptions(emp::Random & random, size_t correct_target, size_t incorrect_target);
-  void ShuffleOptions(emp::Random & random);
+  void Save(CacheWriter & out) const override;
+  void Load(CacheReader & in) override;
 
   void Validate() override;
-  void Generate(emp::Random & random) override;
+  QuestionLayout DefaultLayout() const override;
+  QuestionLayout Generate(emp::Random & random, GenerateCounts & counts) const override;
 };
\ No newline at end of file
@@ -2,24 +2,24 @@
 
 using emp::MakeCount;
 
-void Question_ShortAnswer::Print(std::ostream& os) const {
+void Question_ShortAnswer::Print(std::ostream& os, const QuestionLayout &) const {
   os << "%- QUESTION " << id << "\n" << question << "\n";
-  for (const String & option : answers) {
-    os << option << '\n';
+  for (size_t i = 0; i < _CountOptionTexts(); ++i) {
+    os << _GetOptionText(i) << '\n';
   }
-  os << std::endl;
+  os << '\n';
 }
 
-void Question_ShortAnswer::PrintD2L(std::ostream& os) const {
+void Question_ShortAnswer::PrintD2L(std::ostream& os, const QuestionLayout & layout) const {
   os << "NewQuestion,SA,,,\n"
     << "ID,QBL-" << id << ",,,\n"
     << "Title,,,,\n"
-    << "QuestionText," << TextToD2L(question) << ",HTML,,\n"
+    << "QuestionText," << RenderQuestion(layout, TextFormat::D2L) << ",HTML,,\n"
     << "Points," << points << ",,,\n"
     << "Difficulty,1,,,\n"
     << "Image,,,,\n";
-  for (const String & option : answers) {
-    os << "Answer,100," << TextToD2L(option) << ",HTML,\n";
+  for (size_t i = 0; i < _CountOptionTexts(); ++i) {
+    os << "Answer,100," << RenderOption(i, TextFormat::D2L) << ",HTML,\n";
   }
   os << "Hint," << hint << ",,,\n"
      << "Feedback," << explanation << ",HTML,,\n"
@@ -27,7 +27,8 @@ void Question_ShortAnswer::PrintD2L(std::ostream& os) const {
      << ",,,,\n";
 }
 
-void Question_ShortAnswer::PrintGradeScope(std::ostream& os, size_t q_num, bool compressed) const {
+void Question_ShortAnswer::PrintGradeScope(std::ostream& os, const QuestionLayout &,
+                                           size_t q_num, bool compressed) const {
   os << "NEED TO UPDATE!!!!\n";
   (void) os;
   (void) q_num;
@@ -46,43 +47,49 @@ void Question_ShortAnswer::PrintGradeScope(std::ostream& os, size_t q_num, bool
   // os << "\\end{itemize}\n" << std::endl;
 }
 
-void Question_ShortAnswer::PrintHTML(std::ostream & os, size_t q_num) const {
+void Question_ShortAnswer::PrintHTML(std::ostream & os, const QuestionLayout & layout,
+                                     size_t q_num) const {
   os << "  <!-- Question " << id << " -->\n"
      << "  <div class=\"question\">\n"
      << "    <p><b>";
   if (q_num) os << q_num << ".</b> ";  // If we were given a number > 0, print it.
-  os << TextToHTML(question) <<  "</p>\n";
+  os << RenderQuestion(layout, TextFormat::HTML) <<  "</p>\n";
   os << "<input type=\"text\" id=\"q" << id << "\">\n";
   
   // Leave a div to place the answer.
   os << "  <div class=\"answer\" data-question=\"q" << id << "\"></div> <!-- Placeholder for answer -->"
      << "</div>\n"
-     << std::endl; // Skip a line.
+     << '\n'; // Skip a line.
 }
 
-void Question_ShortAnswer::PrintJS(std::ostream & os) const {
-  _TestError(answers.size() == 0,
+void Question_ShortAnswer::PrintJS(std::ostream & os, const QuestionLayout &) const {
+  const size_t answer_count = _CountOptionTexts();
+  _TestError(answer_count == 0,
     "Web mode a correct answer for each question, but none found.");
-  _TestWarning(answers.size() > 1,
-    "Web mode expects only one correct answer per question; ", answers.size(), " found.");
-  os << "    q" << id << ": \"" << answers[0] << "\",\n";
+  _TestWarning(answer_count > 1,
+    "Web mode expects only one correct answer per question; ", answer_count, " found.");
+  os << "    q" << id << ": \"" << _GetOptionText(0) << "\",\n";
 }
 
-void Question_ShortAnswer::PrintLatex(std::ostream& os) const {
+void Question_ShortAnswer::PrintLatex(std::ostream& os, const QuestionLayout & layout) const {
   os << "% QUESTION " << id << "\n"
-     << "\\question " << TextToLatex(question) << "\n"
-     << std::endl
+     << "\\question " << RenderQuestion(layout, TextFormat::LATEX) << "\n"
+     << '\n'
      << "\\begin{saanswer}";
-  os << std::endl;
+  os << '\n';
 
-  for (const String & option : answers) {
-    os << option << '\n';
+  for (size_t i = 0; i < _CountOptionTexts(); ++i) {
+    os << _GetOptionText(i) << '\n';
   }
 
-  os << "\\end{saanswer}\n" << std::endl;
+  os << "\\end{saanswer}\n" << '\n';
 }
 
+void Question_ShortAnswer::Save(CacheWriter & out) const { _SaveBase(out); }
+
+void Question_ShortAnswer::Load(CacheReader & in) { _LoadBase(in); }
+
 void Question_ShortAnswer::Validate() {
   // Is there at least one valid answer?
-  _TestError(answers.size() == 0, "At least one answer required.");
+  _TestError(_CountOptionTexts() == 0, "At least one answer required.");
 }
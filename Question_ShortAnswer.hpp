@@ -3,38 +3,46 @@
 #include "Question.hpp"
 
 // A class to define multiple-choice style questions.
-class Question_ShortAnswer : public Question {
+class Question_ShortAnswer final : public Question {
 private:
-  emp::vector<String> answers;
+  // Accepted answers are stored as the option text (in the base class).
   // bool case_sensitive = false; ///< Should we only allow answers with correct case?
   // bool is_numeric = false;     ///< Should we allow equivalent numerical values?
 
 public:
-  Question_ShortAnswer() { }
-  Question_ShortAnswer(size_t id) : Question(id) { }  ///< Constructor that specified ID.
+  Question_ShortAnswer() : Question(QType::SHORT_ANSWER) { }
+  Question_ShortAnswer(size_t id)   ///< Constructor that specified ID.
+    : Question(QType::SHORT_ANSWER, id) { }
   Question_ShortAnswer(const Question_ShortAnswer &) = default;  ///< Copy Constructor
   Question_ShortAnswer(Question_ShortAnswer &&) = default;       ///< Move Constructor
 
   Question_ShortAnswer & operator=(const Question_ShortAnswer &) = default;
   Question_ShortAnswer & operator=(Question_ShortAnswer &&) = default;
 
-  void AddOption(const emp::String &) override {
+  void AddOption(std::string_view) override {
     _Error("Short answer questions should not have a multi-line answer.");
   }
 
-  void AddOption(emp::String tag, const emp::String & answer) override {
+  void AddOption(std::string_view tag, std::string_view answer) override {
     // For now, use a * for the tag and the answer indicates the correct answer.
     _TestError(tag != ">", "Only '>' should be used to denote a correct answer.");
-    answers.push_back(answer);
+    _PushOptionText(answer);
   }
 
-  void Print(std::ostream & os=std::cout) const override;
-  void PrintD2L(std::ostream & os=std::cout) const override;
-  void PrintGradeScope(std::ostream & os=std::cout, size_t q_num=0, bool compressed = false) const override;
-  void PrintHTML(std::ostream & os=std::cout, size_t q_num=0) const override;
-  void PrintJS(std::ostream & os=std::cout) const override;
-  void PrintLatex(std::ostream & os=std::cout) const override;
+  void Print(std::ostream & os, const QuestionLayout & layout) const override;
+  void PrintD2L(std::ostream & os, const QuestionLayout & layout) const override;
+  void PrintGradeScope(std::ostream & os, const QuestionLayout & layout,
+                       size_t q_num=0, bool compressed = false) const override;
+  void PrintHTML(std::ostream & os, const QuestionLayout & layout, size_t q_num=0) const override;
+  void PrintJS(std::ostream & os, const QuestionLayout & layout) const override;
+  void PrintLatex(std::ostream & os, const QuestionLayout & layout) const override;
+
+  void Save(CacheWriter & out) const override;
+  void Load(CacheReader & in) override;
 
   void Validate() override;
-  void Generate(emp::Random &) override { /* No generation needed for short answer. */ }
+  QuestionLayout DefaultLayout() const override { return QuestionLayout{}; }
+  QuestionLayout Generate(emp::Random &, GenerateCounts &) const override {
+    return QuestionLayout{};  // No generation needed for short answer.
+  }
 };
\ No newline at end of file
@@ -0,0 +1,147 @@
+#pragma once
+
+// Where the time goes in a run of QBL: wall-clock and CPU time for each phase, along with
+// counters for the work done, reported as text or JSON.  CPU time covers every thread in the
+// process, so a phase that runs in parallel can use more CPU time than wall-clock time.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <sys/resource.h>
+
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+class RunStats {
+private:
+  struct Phase {
+    emp::String name;
+    double wall_sec = 0.0;
+    double cpu_sec = 0.0;
+  };
+
+  emp::vector<Phase> phases;                                  // In the order first timed.
+  emp::vector<std::pair<emp::String, uint64_t>> counters;     // In the order first set.
+  emp::vector<std::pair<emp::String, uint64_t>> file_bytes;   // Bytes per file, by filename.
+  mutable std::mutex mutex;                                   // Allows adding from any thread.
+
+  static double _CPUSeconds() {
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+         + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+  }
+
+  static uint64_t _PeakRSSKB() {
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_maxrss);   // Kilobytes on Linux.
+  }
+
+  void _AddPhase(const emp::String & name, double wall_sec, double cpu_sec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Phase & phase : phases) {
+      if (phase.name != name) continue;
+      phase.wall_sec += wall_sec;
+      phase.cpu_sec += cpu_sec;
+      return;
+    }
+    phases.push_back(Phase{name, wall_sec, cpu_sec});
+  }
+
+  static void _PrintJSONString(std::ostream & os, std::string_view str) {
+    os << '"';
+    for (char c : str) {
+      if (c == '"' || c == '\\') os << '\\' << c;
+      else if (static_cast<unsigned char>(c) < 0x20) {
+        const char * hex = "0123456789abcdef";
+        os << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+      }
+      else os << c;
+    }
+    os << '"';
+  }
+
+public:
+  // Adds the time from its creation to its destruction to the named phase.
+  class PhaseTimer {
+  private:
+    RunStats & stats;
+    emp::String name;
+    std::chrono::steady_clock::time_point start_wall;
+    double start_cpu;
+
+  public:
+    PhaseTimer(RunStats & _stats, const emp::String & _name)
+      : stats(_stats), name(_name), start_wall(std::chrono::steady_clock::now())
+      , start_cpu(_CPUSeconds()) { }
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer & operator=(const PhaseTimer &) = delete;
+    ~PhaseTimer() {
+      const std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start_wall;
+      stats._AddPhase(name, wall.count(), _CPUSeconds() - start_cpu);
+    }
+  };
+
+  // Time the rest of the current scope as part of the named phase.
+  [[nodiscard]] PhaseTimer Time(const emp::String & name) { return PhaseTimer(*this, name); }
+
+  void SetCounter(const emp::String & name, uint64_t value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto & counter : counters) {
+      if (counter.first == name) { counter.second = value; return; }
+    }
+    counters.emplace_back(name, value);
+  }
+
+  void AddFileBytes(const emp::String & filename, uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto pos = std::lower_bound(file_bytes.begin(), file_bytes.end(), filename,
+      [](const auto & entry, const emp::String & name){ return entry.first < name; });
+    file_bytes.insert(pos, std::make_pair(filename, bytes));
+  }
+
+  void PrintText(std::ostream & os) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    os << "QBL run statistics\n";
+    for (const Phase & phase : phases) {
+      os << "  " << phase.name << ": wall " << phase.wall_sec * 1000.0 << " ms, cpu "
+         << phase.cpu_sec * 1000.0 << " ms\n";
+    }
+    for (const auto & [name, value] : counters) os << "  " << name << ": " << value << '\n';
+    for (const auto & [filename, bytes] : file_bytes) {
+      os << "  bytes written to " << filename << ": " << bytes << '\n';
+    }
+    os << "  peak RSS: " << _PeakRSSKB() << " KB\n";
+  }
+
+  void PrintJSON(std::ostream & os) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    os << "{\n  \"phases\": {";
+    for (size_t i = 0; i < phases.size(); ++i) {
+      os << (i ? ",\n    " : "\n    ");
+      _PrintJSONString(os, phases[i].name.View());
+      os << ": {\"wall_sec\": " << phases[i].wall_sec
+         << ", \"cpu_sec\": " << phases[i].cpu_sec << "}";
+    }
+    os << "\n  },\n  \"counters\": {";
+    for (size_t i = 0; i < counters.size(); ++i) {
+      os << (i ? ",\n    " : "\n    ");
+      _PrintJSONString(os, counters[i].first.View());
+      os << ": " << counters[i].second;
+    }
+    os << "\n  },\n  \"bytes_written\": {";
+    for (size_t i = 0; i < file_bytes.size(); ++i) {
+      os << (i ? ",\n    " : "\n    ");
+      _PrintJSONString(os, file_bytes[i].first.View());
+      os << ": " << file_bytes[i].second;
+    }
+    os << "\n  },\n  \"peak_rss_kb\": " << _PeakRSSKB() << "\n}\n";
+  }
+};
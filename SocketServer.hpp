@@ -0,0 +1,208 @@
+#pragma once
+
+// A small server for a line-based protocol over a Unix domain socket.  Each connection gets
+// its own thread, so idle clients never hold up others, while a semaphore limits how many
+// requests are handled at once.  The time taken by every request is recorded so that latency
+// percentiles can be reported.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <semaphore>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "emp/base/notify.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+// Record of how long each request took (in microseconds).
+class LatencyStats {
+private:
+  mutable std::mutex mutex;
+  emp::vector<uint64_t> times;
+
+public:
+  void Add(uint64_t usec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    times.push_back(usec);
+  }
+
+  // Summary of request count, percentiles, and maximum latency.
+  std::string Report() const {
+    emp::vector<uint64_t> sorted;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      sorted = times;
+    }
+    std::stringstream ss;
+    ss << "requests: " << sorted.size() << '\n';
+    if (sorted.empty()) return ss.str();
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](size_t pct){ return sorted[(sorted.size() - 1) * pct / 100]; };
+    ss << "p50_us: " << percentile(50) << '\n'
+       << "p90_us: " << percentile(90) << '\n'
+       << "p99_us: " << percentile(99) << '\n'
+       << "max_us: " << sorted.back() << '\n';
+    return ss.str();
+  }
+};
+
+class SocketServer {
+public:
+  // Given a request line (without its newline), return the full response to send back.
+  using handler_t = std::function<std::string(std::string_view)>;
+
+  static constexpr size_t MAX_REQUEST_SIZE = 1 << 16;   // Longest request line accepted.
+
+private:
+  emp::String socket_path;
+  handler_t handler;
+  int listen_fd = -1;
+  std::counting_semaphore<> active_requests;    // Limits requests being handled at once.
+  LatencyStats stats;
+  std::atomic<bool> stopping{false};
+
+  std::mutex conn_mutex;                        // Protects the connection tracking below.
+  std::condition_variable conn_done;
+  std::unordered_set<int> open_fds;             // Connections currently being served.
+
+  static bool _SendAll(int fd, std::string_view data) {
+    while (data.size()) {
+      const ssize_t count = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+      if (count < 0) {
+        if (errno == EINTR) continue;
+        return false;
+      }
+      data.remove_prefix(static_cast<size_t>(count));
+    }
+    return true;
+  }
+
+  // Respond to a single request line; returns false if the connection should close.
+  bool _HandleLine(int fd, std::string_view line) {
+    if (line.size() && line.back() == '\r') line.remove_suffix(1);
+    if (line == "quit") return false;
+    if (line == "shutdown") { Stop(); return false; }
+    if (line == "stats") {
+      const std::string report = stats.Report();
+      return _SendAll(fd, "OK size=" + std::to_string(report.size()) + "\n" + report);
+    }
+
+    // Time includes any wait for a free slot, as seen by the client.
+    const auto start_time = std::chrono::steady_clock::now();
+    active_requests.acquire();
+    const std::string response = handler(line);
+    active_requests.release();
+    const bool sent = _SendAll(fd, response);
+    const auto elapsed = std::chrono::steady_clock::now() - start_time;
+    stats.Add(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    return sent;
+  }
+
+  void _ServeConnection(int fd) {
+    std::string buffer;
+    char chunk[4096];
+    bool keep_going = true;
+    while (keep_going && !stopping) {
+      const ssize_t count = ::recv(fd, chunk, sizeof(chunk), 0);
+      if (count < 0 && errno == EINTR) continue;
+      if (count <= 0) break;
+      buffer.append(chunk, static_cast<size_t>(count));
+
+      size_t line_start = 0;
+      for (size_t line_end = buffer.find('\n'); keep_going && line_end != std::string::npos;
+           line_end = buffer.find('\n', line_start)) {
+        keep_going = _HandleLine(fd, std::string_view(buffer).substr(line_start, line_end - line_start));
+        line_start = line_end + 1;
+      }
+      buffer.erase(0, line_start);
+      if (buffer.size() > MAX_REQUEST_SIZE) {
+        _SendAll(fd, "ERROR Request too long.\n");
+        break;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(conn_mutex);
+    ::close(fd);
+    open_fds.erase(fd);
+    conn_done.notify_all();
+  }
+
+public:
+  SocketServer(const emp::String & _path, size_t max_active, handler_t _handler)
+    : socket_path(_path), handler(std::move(_handler))
+    , active_requests(static_cast<std::ptrdiff_t>(std::max<size_t>(max_active, 1))) { }
+  SocketServer(const SocketServer &) = delete;
+  SocketServer & operator=(const SocketServer &) = delete;
+  ~SocketServer() { if (listen_fd >= 0) ::close(listen_fd); }
+
+  const LatencyStats & GetStats() const { return stats; }
+
+  // Create the socket (replacing any stale one at the same path); return success.
+  bool Open() {
+    const std::string path(socket_path.begin(), socket_path.end());
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+      emp::notify::Error("Socket path '", socket_path, "' is too long.");
+      return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+      emp::notify::Error("Unable to create socket: ", std::strerror(errno));
+      return false;
+    }
+    ::unlink(path.c_str());
+    if (::bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listen_fd, SOMAXCONN) < 0) {
+      emp::notify::Error("Unable to listen on socket '", socket_path, "': ", std::strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  // Accept connections until Stop() is called, then wait for open connections to finish.
+  void Run() {
+    while (!stopping) {
+      const int fd = ::accept(listen_fd, nullptr, nullptr);
+      if (fd < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) continue;
+        break;   // Listening socket was shut down (or failed).
+      }
+      std::lock_guard<std::mutex> lock(conn_mutex);
+      if (stopping) { ::close(fd); break; }
+      open_fds.insert(fd);
+      std::thread([this, fd](){ _ServeConnection(fd); }).detach();
+    }
+
+    std::unique_lock<std::mutex> lock(conn_mutex);
+    conn_done.wait(lock, [this](){ return open_fds.empty(); });
+    lock.unlock();
+
+    const std::string path(socket_path.begin(), socket_path.end());
+    ::unlink(path.c_str());
+  }
+
+  // Stop accepting connections; safe to call from any connection thread.
+  void Stop() {
+    std::lock_guard<std::mutex> lock(conn_mutex);
+    stopping = true;
+    ::shutdown(listen_fd, SHUT_RDWR);
+    for (int fd : open_fds) ::shutdown(fd, SHUT_RD);
+  }
+};
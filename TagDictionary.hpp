@@ -0,0 +1,57 @@
+#pragma once
+
+// A bank-wide dictionary that maps each distinct tag string to a small integer ID, so that
+// questions can store and compare tags as integers.
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+class TagDictionary {
+public:
+  using tag_id_t = uint32_t;
+  static constexpr tag_id_t NO_TAG = static_cast<tag_id_t>(-1);  ///< ID for unknown tags.
+
+private:
+  // Allow lookups by string_view without building a temporary string.
+  struct ViewHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+  };
+
+  emp::vector<emp::String> names;                                          ///< Tag for each ID.
+  std::unordered_map<std::string, tag_id_t, ViewHash, std::equal_to<>> ids;  ///< ID for each tag.
+
+public:
+  size_t size() const { return names.size(); }
+
+  // Return the ID for a tag, adding it to the dictionary if needed.
+  tag_id_t Intern(std::string_view tag) {
+    auto it = ids.find(tag);
+    if (it != ids.end()) return it->second;
+    const tag_id_t new_id = static_cast<tag_id_t>(names.size());
+    ids.emplace(std::string(tag), new_id);
+    names.emplace_back(tag);
+    return new_id;
+  }
+
+  // Return the ID for a tag, or NO_TAG if no question uses it.
+  tag_id_t GetID(std::string_view tag) const {
+    auto it = ids.find(tag);
+    return (it == ids.end()) ? NO_TAG : it->second;
+  }
+
+  emp::vector<tag_id_t> GetIDs(const emp::vector<emp::String> & tags) const {
+    emp::vector<tag_id_t> out;
+    out.reserve(tags.size());
+    for (const auto & tag : tags) out.push_back(GetID(tag.View()));
+    return out;
+  }
+
+  const emp::String & GetName(tag_id_t id) const { return names[id]; }
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+// Storage for the text (and small arrays) of many questions, allocated in large blocks.  Each
+// piece is copied in once and never moves, so questions can refer to it directly with
+// std::string_view and std::span; everything is released together when the arena is cleared
+// or destroyed.  Like TypedPool, an arena can take over another arena's blocks (as when the
+// shards of a parallel load are merged) without moving or rebasing anything.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "emp/base/vector.hpp"
+
+class TextArena {
+private:
+  static constexpr size_t BLOCK_SIZE = 1 << 16;     ///< Bytes in a standard block.
+  static constexpr size_t LARGE_PIECE = BLOCK_SIZE / 4;  ///< Bigger pieces get their own block.
+
+  emp::vector<std::unique_ptr<std::byte[]>> blocks;
+  std::byte * next = nullptr;         ///< Next free byte in the current block.
+  size_t free_bytes = 0;              ///< Bytes left in the current block.
+  size_t used_bytes = 0;              ///< Total bytes handed out.
+
+  // Reserve space for count objects of type T.  Blocks come from new[], so they are aligned
+  // for any basic type; pieces are padded to the alignment of T within a block.
+  template <typename T>
+  T * _Alloc(size_t count) {
+    const size_t bytes = count * sizeof(T);
+    used_bytes += bytes;
+    if (bytes > LARGE_PIECE) {
+      blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(bytes));
+      return reinterpret_cast<T *>(blocks.back().get());
+    }
+    size_t pad = (alignof(T) - reinterpret_cast<uintptr_t>(next) % alignof(T)) % alignof(T);
+    if (pad + bytes > free_bytes) {
+      blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(BLOCK_SIZE));
+      next = blocks.back().get();
+      free_bytes = BLOCK_SIZE;
+      pad = 0;
+    }
+    T * out = reinterpret_cast<T *>(next + pad);
+    next += pad + bytes;
+    free_bytes -= pad + bytes;
+    return out;
+  }
+
+public:
+  TextArena() = default;
+  TextArena(const TextArena &) = delete;
+  TextArena(TextArena && in) : blocks(std::move(in.blocks)), next(in.next),
+    free_bytes(in.free_bytes), used_bytes(in.used_bytes) { in.Clear(); }
+  TextArena & operator=(const TextArena &) = delete;
+  TextArena & operator=(TextArena &&) = delete;
+
+  size_t GetUsedBytes() const { return used_bytes; }
+
+  // Copy text into the arena and return a view of the copy.
+  std::string_view AddText(std::string_view text) {
+    if (text.empty()) return {};
+    char * out = _Alloc<char>(text.size());
+    std::memcpy(out, text.data(), text.size());
+    return std::string_view(out, text.size());
+  }
+
+  // Copy an array of plain values into the arena.
+  template <typename T>
+  std::span<const T> AddArray(const T * values, size_t count) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (count == 0) return {};
+    T * out = _Alloc<T>(count);
+    std::memcpy(out, values, count * sizeof(T));
+    return std::span<const T>(out, count);
+  }
+  template <typename T>
+  std::span<const T> AddArray(const emp::vector<T> & values) {
+    return AddArray(values.data(), values.size());
+  }
+
+  // Space for an array of plain values, to be filled in by the caller.
+  template <typename T>
+  std::span<T> NewArray(size_t count) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (count == 0) return {};
+    return std::span<T>(_Alloc<T>(count), count);
+  }
+
+  // Take over all of the blocks from another arena (their contents stay where they are).
+  void Absorb(TextArena && in) {
+    for (auto & block : in.blocks) blocks.push_back(std::move(block));
+    used_bytes += in.used_bytes;
+    in.Clear();
+  }
+
+  void Clear() {
+    blocks.clear();
+    next = nullptr;
+    free_bytes = 0;
+    used_bytes = 0;
+  }
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+// Storage for many objects of a single type, allocated in large blocks.  Objects never move
+// once created, and they are all released together when the pool is cleared or destroyed, so
+// a pool of N objects costs about N / BLOCK_SIZE allocations instead of N.
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "emp/base/vector.hpp"
+
+template <typename T, size_t BLOCK_SIZE=256>
+class TypedPool {
+private:
+  struct alignas(T) Slot { std::byte bytes[sizeof(T)]; };
+
+  struct Block {
+    std::unique_ptr<Slot[]> slots;
+    size_t used = 0;                  ///< Number of slots holding live objects.
+
+    T * Get(size_t pos) { return std::launder(reinterpret_cast<T *>(slots[pos].bytes)); }
+  };
+
+  emp::vector<Block> blocks;
+  size_t count = 0;                   ///< Total number of live objects.
+
+public:
+  TypedPool() = default;
+  TypedPool(const TypedPool &) = delete;
+  TypedPool(TypedPool && in) : blocks(std::move(in.blocks)), count(in.count) {
+    in.blocks.clear();
+    in.count = 0;
+  }
+  TypedPool & operator=(const TypedPool &) = delete;
+  TypedPool & operator=(TypedPool &&) = delete;
+  ~TypedPool() { Clear(); }
+
+  size_t size() const { return count; }
+
+  // Construct a new object in the pool; the pool keeps ownership.
+  template <typename... ARGS>
+  T * New(ARGS &&... args) {
+    if (blocks.empty() || blocks.back().used == BLOCK_SIZE) {
+      blocks.push_back(Block{std::unique_ptr<Slot[]>(new Slot[BLOCK_SIZE]), 0});
+    }
+    Block & block = blocks.back();
+    T * obj = new (block.slots[block.used].bytes) T(std::forward<ARGS>(args)...);
+    ++block.used;
+    ++count;
+    return obj;
+  }
+
+  // Destroy the most recently added objects so that only the first keep_count remain.
+  void ShrinkTo(size_t keep_count) {
+    while (count > keep_count) {
+      Block & block = blocks.back();
+      block.Get(--block.used)->~T();
+      --count;
+      if (block.used == 0) blocks.pop_back();
+    }
+  }
+
+  // Take over all of the objects from another pool (they stay at the same addresses).
+  void Absorb(TypedPool && in) {
+    for (Block & block : in.blocks) blocks.push_back(std::move(block));
+    count += in.count;
+    in.blocks.clear();
+    in.count = 0;
+  }
+
+  void Clear() {
+    for (Block & block : blocks) {
+      for (size_t pos = 0; pos < block.used; ++pos) block.Get(pos)->~T();
+    }
+    blocks.clear();
+    count = 0;
+  }
+};
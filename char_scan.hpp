@@ -0,0 +1,104 @@
+#pragma once
+
+// Find the next "special" character in a block of text, so that the plain runs in between can
+// be skipped (and copied) in bulk.  Uses AVX2 when the CPU supports it, SSE2 on any other
+// x86-64 machine, and a table lookup everywhere else.
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+#if defined(__SSE2__)
+#define QBL_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+class CharScanner {
+public:
+  static constexpr size_t MAX_CHARS = 16;   ///< Most specific chars that can be vectorized.
+
+private:
+  std::array<bool, 256> is_special{};       ///< Lookup for every byte value.
+  std::array<char, MAX_CHARS> chars{};      ///< The special chars (below 0x80).
+  size_t num_chars = 0;
+  bool high_bytes = false;                  ///< Are all bytes >= 0x80 special?
+
+  const char * _FindScalar(const char * pos, const char * end) const {
+    while (pos < end && !IsSpecial(*pos)) ++pos;
+    return pos;
+  }
+
+#ifdef QBL_SCAN_X86
+  // Bitmask of the special chars in a block of 16 bytes.
+  unsigned _Mask16(__m128i block) const {
+    __m128i hits = _mm_setzero_si128();
+    for (size_t i = 0; i < num_chars; ++i) {
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(chars[i])));
+    }
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+    if (high_bytes) mask |= static_cast<unsigned>(_mm_movemask_epi8(block));
+    return mask;
+  }
+
+  const char * _FindSSE2(const char * pos, const char * end) const {
+    for (; end - pos >= 16; pos += 16) {
+      const unsigned mask = _Mask16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pos)));
+      if (mask) return pos + __builtin_ctz(mask);
+    }
+    return _FindScalar(pos, end);
+  }
+
+  __attribute__((target("avx2")))
+  const char * _FindAVX2(const char * pos, const char * end) const {
+    for (; end - pos >= 32; pos += 32) {
+      const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pos));
+      __m256i hits = _mm256_setzero_si256();
+      for (size_t i = 0; i < num_chars; ++i) {
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(chars[i])));
+      }
+      unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+      if (high_bytes) mask |= static_cast<unsigned>(_mm256_movemask_epi8(block));
+      if (mask) return pos + __builtin_ctz(mask);
+    }
+    return _FindSSE2(pos, end);
+  }
+
+  static bool _HasAVX2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+  }
+#endif
+
+public:
+  constexpr CharScanner() = default;
+
+  // Special chars must be below 0x80; use high_bytes to make every byte >= 0x80 special.
+  constexpr CharScanner(std::string_view special_chars, bool _high_bytes=false)
+    : high_bytes(_high_bytes)
+  {
+    for (char c : special_chars) AddChar(c);
+    if (high_bytes) {
+      for (size_t i = 128; i < 256; ++i) is_special[i] = true;
+    }
+  }
+
+  constexpr void AddChar(char c) {
+    const auto id = static_cast<unsigned char>(c);
+    if (is_special[id]) return;
+    is_special[id] = true;
+    if (num_chars < MAX_CHARS) chars[num_chars] = c;
+    ++num_chars;
+  }
+
+  constexpr bool IsSpecial(char c) const { return is_special[static_cast<unsigned char>(c)]; }
+
+  // Return the first position in [pos, end) holding a special char, or end if there is none.
+  const char * Find(const char * pos, const char * end) const {
+#ifdef QBL_SCAN_X86
+    if (num_chars <= MAX_CHARS) {
+      return _HasAVX2() ? _FindAVX2(pos, end) : _FindSSE2(pos, end);
+    }
+#endif
+    return _FindScalar(pos, end);
+  }
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+// Reporting errors in question files and text.  Normally an error ends the program, after
+// writing out any output still held in OutputStream buffers, so a run that fails part way
+// leaves everything printed before the error.
+//
+// A server should instead turn away the bad input and keep going.  While an ErrorTrap is
+// active on a thread, errors reported there are recorded in the trap and the code that found
+// them carries on; whoever set the trap checks it when the work is done and throws away the
+// results if anything went wrong.
+
+#include <cstdlib>
+#include <mutex>
+#include <utility>
+
+#include "emp/base/notify.hpp"
+#include "emp/tools/String.hpp"
+
+#include "OutputStream.hpp"
+
+class ErrorTrap {
+private:
+  static inline thread_local ErrorTrap * active = nullptr;
+
+  ErrorTrap * prev_active;            ///< Trap to restore when this one ends.
+  mutable std::mutex mutex;           ///< Errors may come from any thread sharing the trap.
+  emp::String first_error;            ///< Message for the first error caught.
+  size_t error_count = 0;             ///< Total number of errors caught.
+
+public:
+  ErrorTrap() : prev_active(active) { active = this; }
+  ErrorTrap(const ErrorTrap &) = delete;
+  ErrorTrap & operator=(const ErrorTrap &) = delete;
+  ~ErrorTrap() { active = prev_active; }
+
+  // Make a trap active on the current thread until the end of the scope; used to extend a
+  // trap to worker threads (nullptr leaves errors on that thread untrapped).
+  class Share {
+  private:
+    ErrorTrap * prev_active;
+  public:
+    Share(ErrorTrap * trap) : prev_active(active) { active = trap; }
+    Share(const Share &) = delete;
+    Share & operator=(const Share &) = delete;
+    ~Share() { active = prev_active; }
+  };
+
+  static ErrorTrap * GetActive() { return active; }
+
+  bool HasError() const { std::lock_guard<std::mutex> lock(mutex); return error_count; }
+  size_t GetErrorCount() const { std::lock_guard<std::mutex> lock(mutex); return error_count; }
+  emp::String GetError() const { std::lock_guard<std::mutex> lock(mutex); return first_error; }
+
+  void AddError(emp::String message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error_count++ == 0) first_error = std::move(message);
+  }
+};
+
+// Report an error: recorded by the active trap if there is one, otherwise fatal.
+template <typename... Ts>
+void ReportError(Ts &&... args) {
+  if (ErrorTrap * trap = ErrorTrap::GetActive()) {
+    trap->AddError(emp::MakeString(std::forward<Ts>(args)...));
+    return;
+  }
+  OutputBuffer::FlushAll();
+  emp::notify::Error(std::forward<Ts>(args)...);
+  std::exit(1);
+}
+
+template <typename... Ts>
+bool TestReportError(bool test, Ts &&... args) {
+  if (test) ReportError(std::forward<Ts>(args)...);
+  return test;
+}
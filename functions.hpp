@@ -1,376 +1,459 @@
 #pragma once
 
-#include "emp/base/notify.hpp"
+// Conversion of QBL text (with its inline markup) to each output format.
+//
+// Inline markup:  \\ literal backslash,  \n forced line break,  `...` inline code,
+//                 \&name; HTML entity,   \<name> HTML tag,       four leading spaces for a
+//                 code-block line.
+//
+// Text is lexed once into a compact token stream, which is then written out by a small
+// table-driven emitter for the requested format, straight into a single output buffer.
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "emp/base/assert.hpp"
 #include "emp/base/vector.hpp"
 #include "emp/tools/String.hpp"
 
-static inline emp::String LineToRawText(emp::String line) {
-  emp::String out_line;
-
-  // Everything between backslash \& and ; or \< to > ignore.
-  char scan_to = '\0';
-  bool start_scan = false;
-  emp::String scan_word;
-
-  // If we have a negative value, we need to wait for another char to know the symbol
-  char partial = '\0';
-  for (char c : line) {
-    if (partial) {
-      int val1 = static_cast<int>(partial);
-      int val2 = static_cast<int>(c);
-      switch (val1) {
-      case -50:
-        switch (val2) {
-        case -87: out_line += "O"; break;
-        case -104: out_line += "T"; break;
-        default:
-          emp::notify::Error("Unknown char combo: ", val1, ",", val2, "\nline: ", line);          
-        }
-        break;
-      default:
-        emp::notify::Error("Unknown char combo: ", val1, ",", val2, "\nline: ", line);          
-      }
-      partial = '\0';
+#include "char_scan.hpp"
+#include "errors.hpp"
+
+enum class TextFormat { RAW = 0, D2L, LATEX, HTML };
+static constexpr size_t NUM_TEXT_FORMATS = 4;
+
+struct MarkupToken {
+  enum Type : uint8_t {
+    TEXT = 0,     // Run of plain characters.
+    SYMBOL,       // Two-byte character (only when pairing symbols).
+    BACKSLASH,    // "\\"
+    LINE_BREAK,   // "\n"
+    ENTITY,       // "\&name;"  (source span starts at '&')
+    TAG,          // "\<name>"  (source span starts at '<')
+    BAD_ESCAPE,   // Backslash followed by an unknown character (at start).
+    TICK,         // "`"
+    CODE_BLOCK,   // Line starts with four spaces; size is the count of any further spaces.
+    NEWLINE       // End of one line of a multi-line text.
+  };
+
+  Type type = TEXT;
+  bool closed = true;       ///< ENTITY / TAG: was the terminating char found?
+  uint32_t start = 0;       ///< Position in source text.
+  uint32_t size = 0;        ///< Number of source chars (or spaces for CODE_BLOCK).
+  uint32_t word_start = 0;  ///< ENTITY / TAG: name position in the word buffer.
+  uint32_t word_size = 0;   ///< ENTITY / TAG: name length.
+};
+
+struct MarkupTokens {
+  std::string_view source;            ///< Text that was lexed (must outlive the tokens).
+  emp::vector<MarkupToken> tokens;
+  std::string words;                  ///< Names of all entities and tags, back to back.
+  bool pair_symbols = false;          ///< Were bytes >= 0x80 read as two-byte symbols?
+  bool by_line = true;                ///< Was the text split into lines?
+
+  std::string_view GetWord(const MarkupToken & token) const {
+    return std::string_view(words).substr(token.word_start, token.word_size);
+  }
+};
+
+// Formats differ slightly in how they read text: raw text and Latex read any byte >= 0x80 as
+// the first of a two-byte symbol, and raw text has no code-block lines.  D2L and HTML read
+// text identically and can share tokens.
+static inline bool MarkupPairsSymbols(TextFormat format) {
+  return format == TextFormat::RAW || format == TextFormat::LATEX;
+}
+
+// Lex the markup in a single line (or a whole text, when not working by line).
+static inline void _LexMarkupLine(MarkupTokens & out, size_t pos, size_t stop) {
+  const std::string_view text = out.source;
+  auto add = [&out](MarkupToken::Type type, size_t start, size_t size) -> MarkupToken & {
+    MarkupToken & token = out.tokens.emplace_back();
+    token.type = type;
+    token.start = static_cast<uint32_t>(start);
+    token.size = static_cast<uint32_t>(size);
+    return token;
+  };
+
+  // Chars that can change the lexer state.
+  static constexpr CharScanner markup_chars("\\`");
+  static constexpr CharScanner markup_symbol_chars("\\`", true);
+  const CharScanner & scanner = out.pair_symbols ? markup_symbol_chars : markup_chars;
+
+  size_t text_start = std::string_view::npos;   // Start of the current run of plain text.
+  auto end_text = [&](size_t end_pos) {
+    if (text_start != std::string_view::npos) add(MarkupToken::TEXT, text_start, end_pos - text_start);
+    text_start = std::string_view::npos;
+  };
+
+  size_t partial = std::string_view::npos;   // Position of first byte of a pending symbol.
+  bool start_scan = false;                   // Was the previous char an (active) backslash?
+  char scan_to = '\0';                       // Inside an entity or tag; char that ends it.
+  size_t scan_start = 0;                     // Position of the '&' or '<' that started it.
+  size_t word_start = 0;                     // Where its name starts in the word buffer.
+
+  for (size_t i = pos; i < stop; ++i) {
+    const char c = text[i];
+
+    // Symbols are read first, whatever state we are in.
+    if (partial != std::string_view::npos) {
+      add(MarkupToken::SYMBOL, partial, 2);
+      partial = std::string_view::npos;
       continue;
     }
-    if (c < 0) {
-      partial = c;
+    if (out.pair_symbols && c < 0) {
+      end_text(i);
+      partial = i;
       continue;
     }
 
-    if (scan_to) {  // Do we need to literally translate?
-      if (scan_to == c) {
-        if (c == ';') {
-          if (scan_word == "Theta") out_line += "T";
-          else if (scan_word == "Omega") out_line += "O";
-        }
+    if (scan_to) {
+      if (c == scan_to) {
+        MarkupToken & token = add(scan_to == ';' ? MarkupToken::ENTITY : MarkupToken::TAG,
+                                  scan_start, i + 1 - scan_start);
+        token.word_start = static_cast<uint32_t>(word_start);
+        token.word_size = static_cast<uint32_t>(out.words.size() - word_start);
         scan_to = '\0';
-        scan_word = "";
-      } else {
-        scan_word += c;
       }
+      else out.words += c;
       continue;
     }
 
     if (start_scan) {
+      start_scan = false;
       switch (c) {
-      case '&': scan_to = ';'; break;
-      case '<': scan_to = '>'; break;
-      case '\\': out_line += c; break;
-      case 'n': out_line += "\\\\ "; break;
-      default:
-        std::cerr << "Error: Unknown escape character '" << c << "'.\n" << std::endl;
-        exit(1);
+      case '&': scan_to = ';'; scan_start = i; break;
+      case '<': scan_to = '>'; scan_start = i; break;
+      case '\\': add(MarkupToken::BACKSLASH, i, 1); break;
+      case 'n': add(MarkupToken::LINE_BREAK, i, 1); break;
+      default: add(MarkupToken::BAD_ESCAPE, i, 1);
       }
-      start_scan = false;
+      word_start = out.words.size();
       continue;
     }
 
     switch (c) {
-      case '\\': start_scan = true; break;
-      case '`':  break;
-      default:
-        out_line += c;
-        break;
+    case '\\': end_text(i); start_scan = true; break;
+    case '`':  end_text(i); add(MarkupToken::TICK, i, 1); break;
+    default:
+      if (text_start == std::string_view::npos) text_start = i;
+      // Skip over the rest of this run of plain text.
+      i = scanner.Find(text.data() + i + 1, text.data() + stop) - text.data() - 1;
     }
   }
 
-  return out_line;
+  end_text(stop);
+  if (scan_to) {   // Entity or tag was never closed.
+    MarkupToken & token = add(scan_to == ';' ? MarkupToken::ENTITY : MarkupToken::TAG,
+                              scan_start, stop - scan_start);
+    token.closed = false;
+  }
 }
 
-// Convert a single line of text to D2L format.
-static inline emp::String LineToD2L(emp::String line) {
-  emp::notify::TestError(line.Has('\n'), "Newline found inside of line: ", line);
-  emp::String out_line;
-
-  bool in_codeblock = line.HasPrefix("    ");
-  bool in_code = in_codeblock;
-
-  // Everything between backslash \& and ; or \< to > make literal
-  char scan_to = '\0';
-  bool start_scan = false;
-
-  if (in_codeblock) {
-    line.PopFixed(4);
-    out_line += "&nbsp;&nbsp;<code>";
+// Lex QBL text for the given format into out, replacing what it held (its buffers are reused).
+// Text is normally handled one line at a time; without by_line, newlines are ordinary
+// characters and markup may continue across them.
+static inline void LexMarkup(MarkupTokens & out, std::string_view text, TextFormat format,
+                             bool by_line=true) {
+  out.source = text;
+  out.tokens.clear();
+  out.words.clear();
+  out.pair_symbols = MarkupPairsSymbols(format);
+  out.by_line = by_line;
+  out.tokens.reserve(text.size() / 8 + 4);
+
+  if (!out.by_line) {
+    _LexMarkupLine(out, 0, text.size());
+    return;
   }
 
-  for (char c : line) {
-    if (scan_to) {
-      out_line += c;
-      if (scan_to == c) scan_to = '\0';
-      continue;
+  size_t pos = 0;
+  while (true) {
+    size_t line_end = text.find('\n', pos);
+    if (line_end == std::string_view::npos) line_end = text.size();
+
+    // Lines starting with four spaces are code blocks.
+    if (format != TextFormat::RAW && text.substr(pos, line_end - pos).starts_with("    ")) {
+      size_t ws_end = pos + 4;
+      while (ws_end < line_end && text[ws_end] == ' ') ++ws_end;
+      MarkupToken & token = out.tokens.emplace_back();
+      token.type = MarkupToken::CODE_BLOCK;
+      token.start = static_cast<uint32_t>(pos);
+      token.size = static_cast<uint32_t>(ws_end - pos - 4);
+      pos = ws_end;
     }
 
-    if (start_scan) {
-      switch (c) {
-      case '&': out_line += c; scan_to = ';'; break;
-      case '<': out_line += c; scan_to = '>'; break;
-      case '\\': out_line += c; break;
-      case '\n': out_line += "<br>"; break;
-      default:
-        std::cerr << "Error: Unknown escape character '" << c << "'.\n" << std::endl;
-        exit(1);
-      }
-      start_scan = false;
-      continue;
-    }
+    _LexMarkupLine(out, pos, line_end);
+    if (line_end == text.size()) break;
 
-    switch (c) {
-      case '\"': out_line += "&quot;"; break;
-      case ' ': out_line += in_code ? "&nbsp;" : " ";  break;
-      case ',': out_line += "&#44;";   break;
-      case '<': out_line += in_code ? "&lt;" : "<"; break;  // Outside code might be HTML
-      case '>': out_line += in_code ? "&gt;" : ">"; break;  // Outside code might be HTML
-      case '&': out_line += in_code ? "&amp;" : "&"; break;  // Outside code might be HTML
-      case '\\': start_scan = true; break;
-
-      // Replace ` with <code> or </code>
-      case '`':
-        if (in_codeblock) {
-          out_line += '`';
-        } else {
-          if (in_code) out_line += "</code>";
-          else out_line += "<code>";
-          in_code = !in_code;
-        }
-        break;
-
-      default:
-        out_line += c;
-        break;
-    }
+    MarkupToken & token = out.tokens.emplace_back();
+    token.type = MarkupToken::NEWLINE;
+    token.start = static_cast<uint32_t>(line_end);
+    token.size = 1;
+    pos = line_end + 1;
   }
-
-  // If we are in code at the end of the entry, close it off.
-  if (in_code) out_line += "</code>";
-
-  return out_line;
 }
 
-static inline emp::String LineToLatex(emp::String line) {
-  emp::notify::TestError(line.Has('\n'), "Newline found inside of line: ", line);
-  emp::String out_line;
-
-  bool in_codeblock = line.HasPrefix("    ");
-  bool in_code = in_codeblock;
-
-  // Everything between backslash \& and ; or \< to > make literal
-  char scan_to = '\0';
-  bool start_scan = false;
-  emp::String scan_word;
+static inline MarkupTokens LexMarkup(std::string_view text, TextFormat format, bool by_line=true) {
+  MarkupTokens out;
+  LexMarkup(out, text, format, by_line);
+  return out;
+}
 
-  // If we have a negative value, we need to wait for another char to know the symbol
-  char partial = '\0';
+// Everything an emitter needs to know about an output format.
+struct MarkupStyle {
+  struct char_table_t {
+    std::array<std::string_view, 256> out{};   ///< Replacement for each char.
+    CharScanner replace;                       ///< Which chars need replacing?
+  };
+
+  char_table_t text_chars;             ///< Replacements in normal text.
+  char_table_t code_chars;             ///< Replacements inside code.
+  std::string_view code_open;          ///< Start of inline code (empty = drop backticks).
+  std::string_view code_close;
+  std::string_view line_break;         ///< Output for "\n" (empty = not allowed).
+  std::string_view newline;            ///< Output between lines.
+  std::string_view omega, theta;       ///< Output for these symbols / entities.
+  bool copy_markup;                    ///< Copy entities and tags through unchanged?
+  bool latex_tags;                     ///< Convert simple HTML tags to Latex?
+};
+
+static constexpr MarkupStyle::char_table_t
+_MakeCharTable(std::initializer_list<std::pair<char, std::string_view>> entries) {
+  MarkupStyle::char_table_t table{};
+  for (const auto & [c, out] : entries) {
+    table.out[static_cast<unsigned char>(c)] = out;
+    table.replace.AddChar(c);
+  }
+  return table;
+}
 
-  if (in_codeblock) {
-    line.PopFixed(4);
-    out_line += "\\texttt{";
+static inline const MarkupStyle & GetMarkupStyle(TextFormat format) {
+  using namespace std::string_view_literals;
+  static const MarkupStyle raw_style{
+    {}, {}, ""sv, ""sv, "\\\\ "sv, "\n"sv, "O"sv, "T"sv, false, false
+  };
+  static const MarkupStyle d2l_style{
+    _MakeCharTable({{'"', "&quot;"}, {',', "&#44;"}}),
+    _MakeCharTable({{'"', "&quot;"}, {',', "&#44;"}, {' ', "&nbsp;"},
+                    {'<', "&lt;"}, {'>', "&gt;"}, {'&', "&amp;"}}),
+    "<code>"sv, "</code>"sv, ""sv, "<br>"sv, ""sv, ""sv, true, false
+  };
+  static constexpr auto latex_chars =
+    _MakeCharTable({{'{', "\\{"}, {'}', "\\}"}, {'%', "\\%"}, {'$', "\\$"}, {'<', "$<$"},
+                    {'>', "$>$"}, {'~', "$\\sim$"}, {'&', "\\&"}, {'#', "\\#"}, {'_', "\\_"},
+                    {'^', "$\\widehat{}$"}});
+  static constexpr auto html_chars =
+    _MakeCharTable({{'&', "&amp;"}, {'<', "&lt;"}, {'>', "&gt;"}, {'\'', "&apos;"}, {'"', "&quot;"}});
+
+  static const MarkupStyle latex_style{
+    latex_chars, latex_chars,
+    "\\texttt{"sv, "}"sv, "\\\\ "sv, "\\\\\n"sv, "$\\Omega$"sv, "$\\Theta$"sv, false, true
+  };
+  static const MarkupStyle html_style{
+    html_chars, html_chars,
+    "<code>"sv, "</code>"sv, "<br>"sv, "<br>\n"sv, ""sv, ""sv, true, false
+  };
+
+  switch (format) {
+  case TextFormat::RAW:   return raw_style;
+  case TextFormat::D2L:   return d2l_style;
+  case TextFormat::LATEX: return latex_style;
+  case TextFormat::HTML:  return html_style;
+  }
+  return raw_style;
+}
 
-    size_t ws_count = 0;
-    while (ws_count < line.size() && line[ws_count] == ' ') ++ws_count;
-    out_line += emp::MakeString("\\hspace*{", ws_count+2, "em}");
-    line.PopFixed(ws_count);
+static inline void _MarkupEscapeError(char c) {
+  if (ErrorTrap * trap = ErrorTrap::GetActive()) {
+    trap->AddError(emp::MakeString("Unknown escape character '", c, "'."));
+    return;
   }
+  OutputBuffer::FlushAll();
+  std::cerr << "Error: Unknown escape character '" << c << "'.\n" << std::endl;
+  exit(1);
+}
 
-  for (char c : line) {
-    if (partial) {
-      int val1 = static_cast<int>(partial);
-      int val2 = static_cast<int>(c);
-      switch (val1) {
-      case -50:
-        switch (val2) {
-        case -87: out_line += "$\\Omega$"; break;
-        case -104: out_line += "$\\Theta$"; break;
-        default:
-          emp::notify::Error("Unknown char combo: ", val1, ",", val2, "\nline: ", line);          
-        }
-        break;
-      default:
-        emp::notify::Error("Unknown char combo: ", val1, ",", val2, "\nline: ", line);          
+// Write lexed text out in the given format, appending to out.
+static inline void AppendMarkup(std::string & out, const MarkupTokens & tokens, TextFormat format) {
+  emp_assert(tokens.pair_symbols == MarkupPairsSymbols(format),
+             "Tokens were lexed for another format.");
+  const MarkupStyle & style = GetMarkupStyle(format);
+  const std::string_view text = tokens.source;
+  out.reserve(out.size() + text.size() + text.size() / 4 + 16);
+
+  bool in_codeblock = false;  // Is the current line a code block?
+  bool in_code = false;       // Are we currently in code?
+  size_t line_start = 0;      // Start of the current line's text (for error messages).
+
+  for (const MarkupToken & token : tokens.tokens) {
+    switch (token.type) {
+    case MarkupToken::TEXT: {
+      const auto & table = in_code ? style.code_chars : style.text_chars;
+      const char * pos = text.data() + token.start;
+      const char * const end = pos + token.size;
+      while (pos < end) {
+        const char * run = pos;     // Copy runs of unchanged chars in one step.
+        pos = table.replace.Find(pos, end);
+        out.append(run, pos - run);
+        if (pos < end) out += table.out[static_cast<unsigned char>(*pos++)];
       }
-      partial = '\0';
-      continue;
-    }
-    if (c < 0) {
-      partial = c;
-      continue;
+      break;
     }
-
-    if (scan_to) {  // Do we need to literally translate?
-      if (scan_to == c) {
-        if (c == ';') {
-          if (scan_word == "Theta") out_line += "$\\Theta$";
-          else if (scan_word == "Omega") out_line += "$\\Omega$";
-        }
-        else if (c == '>') {
-          if (scan_word == "b") out_line += "\\textbf{";
-          else if (scan_word == "/b") out_line += "}";
-          else if (scan_word == "i") out_line += "\\textit{";
-          else if (scan_word == "/i") out_line += "}";
-          else if (scan_word == "sup") out_line += "\\textsuperscript{";
-          else if (scan_word == "/sup") out_line += "}";
-          else if (scan_word == "sub") out_line += "\\textsubscript{";
-          else if (scan_word == "/sub") out_line += "}";
-        }
-        scan_to = '\0';
-        scan_word = "";
-      } else {
-        scan_word += c;
+    case MarkupToken::SYMBOL: {
+      const int val1 = static_cast<int>(text[token.start]);
+      const int val2 = static_cast<int>(text[token.start+1]);
+      if (val1 == -50 && val2 == -87) out += style.omega;
+      else if (val1 == -50 && val2 == -104) out += style.theta;
+      else {
+        size_t line_end = tokens.by_line ? text.find('\n', line_start) : text.size();
+        if (line_end == std::string_view::npos) line_end = text.size();
+        ReportError("Unknown char combo: ", val1, ",", val2, "\nline: ",
+                    emp::String(text.substr(line_start, line_end - line_start)));
       }
-      continue;
+      break;
     }
-
-    if (start_scan) {
-      switch (c) {
-      case '&': scan_to = ';'; break;
-      case '<': scan_to = '>'; break;
-      case '\\': out_line += c; break;
-      case 'n': out_line += "\\\\ "; break;
-      default:
-        std::cerr << "Error: Unknown escape character '" << c << "'.\n" << std::endl;
-        exit(1);
+    case MarkupToken::BACKSLASH: out += '\\'; break;
+    case MarkupToken::LINE_BREAK:
+      if (style.line_break.empty()) { _MarkupEscapeError('n'); break; }
+      out += style.line_break;
+      break;
+    case MarkupToken::ENTITY:
+    case MarkupToken::TAG: {
+      if (style.copy_markup) { out += text.substr(token.start, token.size); break; }
+      if (!token.closed) break;
+      const std::string_view word = tokens.GetWord(token);
+      if (token.type == MarkupToken::ENTITY) {
+        if (word == "Theta") out += style.theta;
+        else if (word == "Omega") out += style.omega;
       }
-      start_scan = false;
-      continue;
+      else if (style.latex_tags) {
+        if (word == "b") out += "\\textbf{";
+        else if (word == "i") out += "\\textit{";
+        else if (word == "sup") out += "\\textsuperscript{";
+        else if (word == "sub") out += "\\textsubscript{";
+        else if (word == "/b" || word == "/i" || word == "/sup" || word == "/sub") out += '}';
+      }
+      break;
     }
-
-    switch (c) {
-      case '{': out_line += "\\{";  break;
-      case '}': out_line += "\\}";  break;
-      case '%': out_line += "\\%";  break;
-      case '$': out_line += "\\$";  break;
-      case '<': out_line += "$<$";  break;
-      case '>': out_line += "$>$";  break;
-      case '~': out_line += "$\\sim$";  break;
-      case '&': out_line += "\\&";  break;
-      case '#': out_line += "\\#";  break;
-      case '_': out_line += "\\_";  break;
-      case '^': out_line += "$\\widehat{}$"; break;
-      case '\\': start_scan = true; break;
-
-      // Replace ` with \texttt{ or }
-      case '`':
-        if (in_codeblock) {
-          out_line += '`';
-        } else {
-          if (in_code) out_line += "}";
-          else out_line += "\\texttt{";
-          in_code = !in_code;
-        }
-        break;
-
-      default:
-        out_line += c;
-        break;
+    case MarkupToken::BAD_ESCAPE: _MarkupEscapeError(text[token.start]); break;
+    case MarkupToken::TICK:
+      if (style.code_open.empty()) break;          // Backticks are dropped.
+      if (in_codeblock) out += '`';
+      else {
+        out += in_code ? style.code_close : style.code_open;
+        in_code = !in_code;
+      }
+      break;
+    case MarkupToken::CODE_BLOCK:
+      in_codeblock = in_code = true;
+      line_start = token.start + 4 + (format == TextFormat::LATEX ? token.size : 0);
+      if (format == TextFormat::LATEX) {
+        out += "\\texttt{\\hspace*{";
+        out += std::to_string(token.size+2);
+        out += "em}";
+      }
+      else {
+        out += "&nbsp;&nbsp;<code>";
+        for (size_t i = 0; i < token.size; ++i) out += "&nbsp;";
+      }
+      break;
+    case MarkupToken::NEWLINE:
+      if (in_code) out += style.code_close;
+      in_codeblock = in_code = false;
+      out += style.newline;
+      line_start = token.start + 1;
+      break;
     }
   }
 
-  // If we are in code at the end of the entry, close it off.
-  if (in_code) out_line += "}";
-
-  return out_line;
+  if (in_code) out += style.code_close;
 }
 
-static inline emp::String LineToHTML(emp::String line) {
-  emp::notify::TestError(line.Has('\n'), "Newline found inside of line: ", line);
-  emp::String out_line;
-
-  bool in_codeblock = line.HasPrefix("    ");
-  bool in_code = in_codeblock;
+// Convert a whole text block to the given format.
+static inline emp::String TextToFormat(std::string_view text, TextFormat format, bool by_line=true) {
+  std::string out;
+  AppendMarkup(out, LexMarkup(text, format, by_line), format);
+  return emp::String(std::move(out));
+}
 
-  // Everything between backslash \& and ; or \< to > make literal
-  char scan_to = '\0';
-  bool start_scan = false;
+// Working space for converting many texts one after another; reusing it means that each
+// conversion does not need to allocate its own buffers.
+struct MarkupScratch {
+  MarkupTokens tokens;
+  std::string out;
+};
+
+// Convert a whole text block to the given format in scratch space.  The result is only valid
+// until the scratch space is used again.
+static inline std::string_view TextToFormat(std::string_view text, TextFormat format,
+                                            bool by_line, MarkupScratch & scratch) {
+  LexMarkup(scratch.tokens, text, format, by_line);
+  scratch.out.clear();
+  AppendMarkup(scratch.out, scratch.tokens, format);
+  return scratch.out;
+}
 
-  if (in_codeblock) {
-    line.PopFixed(4);
-    out_line += "&nbsp;&nbsp;<code>";
+// Text converted for output: refers to an existing (cached) conversion when there is one, and
+// otherwise holds its own.
+class RenderedText {
+private:
+  std::string_view cached;
+  bool is_cached = false;
+  emp::String owned;
 
-    size_t ws_count = 0;
-    while (ws_count < line.size() && line[ws_count] == ' ') ws_count++;
-    if (ws_count) {
-      out_line += emp::MakeRepeat("&nbsp;", ws_count);
-      line.PopFixed(ws_count);
-    }
-  }
-
-  for (char c : line) {
-    if (scan_to) {  // Do we need to literally translate?
-      out_line += c;
-      if (scan_to == c) scan_to = '\0';
-      continue;
-    }
+public:
+  RenderedText(std::string_view in) : cached(in), is_cached(true) { }
+  RenderedText(emp::String && in) : owned(std::move(in)) { }
 
-    if (start_scan) {
-      switch (c) {
-      case '&': out_line += c; scan_to = ';'; break;
-      case '<': out_line += c; scan_to = '>'; break;
-      case '\\': out_line += c; break;
-      case 'n': out_line += "<br>"; break;
-      default:
-        std::cerr << "Error: Unknown escape character '" << c << "'.\n" << std::endl;
-        exit(1);
-      }
-      start_scan = false;
-      continue;
-    }
+  std::string_view Get() const { return is_cached ? cached : owned.View(); }
+  size_t size() const { return Get().size(); }
 
-    switch (c) {
-      case '&': out_line += "&amp;";  break;
-      case '<': out_line += "&lt;"; break;
-      case '>': out_line += "&gt;"; break;
-      case '\'': out_line += "&apos;"; break;
-      case '"': out_line += "&quot;"; break;
-      case '\\': start_scan = true; break;
-
-      // Replace ` with \texttt{ or }
-      case '`':
-        if (in_codeblock) {
-          out_line += '`';
-        } else {
-          if (in_code) out_line += "</code>";
-          else out_line += "<code>";
-          in_code = !in_code;
-        }
-        break;
-
-      default:
-        out_line += c;
-        break;
-    }
+  friend std::ostream & operator<<(std::ostream & os, const RenderedText & text) {
+    return os << text.Get();
   }
-
-  // If we are in code at the end of the entry, close it off.
-  if (in_code) out_line += "</code>";
-
-  return out_line;
-}
+};
 
 // Convert a whole text block to Raw Text format.
 static inline emp::String TextToRawText(const emp::String & text) {
-  emp::vector<emp::String> lines = text.Slice("\n");
-  for (auto & line : lines) line = LineToRawText(line);
-  return emp::Join(lines, "\n");
+  return TextToFormat(text.View(), TextFormat::RAW);
 }
 
 // Convert a whole text block to D2L format.
 static inline emp::String TextToD2L(const emp::String & text) {
-  emp::vector<emp::String> lines = text.Slice("\n");
-  for (auto & line : lines) line = LineToD2L(line);
-  return emp::Join(lines, "<br>");
+  return TextToFormat(text.View(), TextFormat::D2L);
 }
 
 // Convert a whole text block to Latex format.
 static inline emp::String TextToLatex(const emp::String & text) {
-  emp::vector<emp::String> lines = text.Slice("\n");
-  for (auto & line : lines) line = LineToLatex(line);
-  return emp::Join(lines, "\\\\\n");
+  return TextToFormat(text.View(), TextFormat::LATEX);
 }
 
 // Convert a whole text block to HTML format.
 static inline emp::String TextToHTML(const emp::String & text) {
-  emp::vector<emp::String> lines = text.Slice("\n");
-  for (auto & line : lines) line = LineToHTML(line);
-  return emp::Join(lines, "<br>\n");
+  return TextToFormat(text.View(), TextFormat::HTML);
+}
+
+// Single-line versions of the above.  Raw text has never checked for newlines and is also
+// used on whole texts, so it treats them as ordinary characters.
+static inline emp::String LineToRawText(const emp::String & line) {
+  return TextToFormat(line.View(), TextFormat::RAW, false);
+}
+
+static inline emp::String LineToD2L(const emp::String & line) {
+  TestReportError(line.Has('\n'), "Newline found inside of line: ", line);
+  return TextToD2L(line);
+}
+
+static inline emp::String LineToLatex(const emp::String & line) {
+  TestReportError(line.Has('\n'), "Newline found inside of line: ", line);
+  return TextToLatex(line);
+}
+
+static inline emp::String LineToHTML(const emp::String & line) {
+  TestReportError(line.Has('\n'), "Newline found inside of line: ", line);
+  return TextToHTML(line);
 }
@@ -0,0 +1,42 @@
+#pragma once
+
+// Simple helpers for spreading independent work across threads.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+#include "emp/base/vector.hpp"
+
+#include "errors.hpp"
+
+// Number of threads to use when none has been specified.
+static inline size_t DefaultThreadCount() {
+  const size_t count = std::thread::hardware_concurrency();
+  return count ? count : 1;
+}
+
+// Call fun(i) for every i in [0, count), using up to num_threads threads (including the caller).
+// Work items are handed out dynamically, so uneven items still balance across threads.  An
+// error trap active on the calling thread also catches errors from the other threads.
+template <typename FUN_T>
+static inline void ParallelFor(size_t count, size_t num_threads, FUN_T && fun) {
+  num_threads = std::min(num_threads, count);
+  if (num_threads <= 1) {
+    for (size_t i = 0; i < count; ++i) fun(i);
+    return;
+  }
+
+  std::atomic<size_t> next_id{0};
+  ErrorTrap * const trap = ErrorTrap::GetActive();
+  auto worker = [&next_id, count, &fun, trap](){
+    ErrorTrap::Share share_trap(trap);
+    for (size_t i = next_id++; i < count; i = next_id++) fun(i);
+  };
+
+  emp::vector<std::thread> threads;
+  for (size_t t = 1; t < num_threads; ++t) threads.emplace_back(worker);
+  worker();
+  for (auto & thread : threads) thread.join();
+}